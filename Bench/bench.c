@@ -0,0 +1,184 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h> /* For malloc, realloc, qsort */
+#include <time.h>
+#include <unistd.h> /* For fork */
+#include <sys/resource.h> /* For getrusage */
+#include <sys/wait.h> /* For waitpid */
+
+/* ************************************************** */
+
+double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* ************************************************** */
+
+long bench_peak_rss(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss; /* kB on Linux */
+}
+
+/* ************************************************** */
+/**
+ * Unsampled percentiles and unmeasured CPU time are printed as null. The
+ * percentile keys name the batch, as they're of batch averages.
+ */
+void bench_print(const bench_result_t *r)
+{
+	double ns_op = r->ops ? r->ns / r->ops : 0;
+	double ops_s = r->ns > 0 ? r->ops * 1e9 / r->ns : 0;
+
+	printf("{\"container\":\"%s\",\"workload\":\"%s\",\"el_size\":%zu,"
+			"\"n\":%lu,\"threads\":%u,\"ops\":%lu,\"ns_per_op\":%.3f,"
+			"\"ops_per_s\":%.0f,", r->container, r->workload, r->el_size,
+			r->n, r->threads, r->ops, ns_op, ops_s);
+
+	if (r->p50_batch < 0){
+		printf("\"batch\":null,\"p50_batch_ns\":null,"
+				"\"p99_batch_ns\":null,");
+	} else {
+		printf("\"batch\":%lu,\"p50_batch_ns\":%.3f,"
+				"\"p99_batch_ns\":%.3f,", r->batch, r->p50_batch,
+				r->p99_batch);
+	}
+
+	if (r->cpu_ns < 0){
+		printf("\"cpu_ns\":null,");
+	} else {
+		printf("\"cpu_ns\":%.0f,", r->cpu_ns);
+	}
+
+	printf("\"peak_rss_kb\":%ld}\n", r->rss_kb);
+	fflush(stdout);
+}
+
+/* ************************************************** */
+
+void bench_run_forked(void (*fn)(void *), void *ctx)
+{
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+
+	if (pid == 0){
+		fn(ctx);
+		fflush(stdout);
+		_exit(0);
+	}
+
+	if (pid > 0){
+		waitpid(pid, NULL, 0);
+	} else {
+		fn(ctx); /* No fork, run in place */
+	}
+}
+
+/* ************************************************** */
+
+void bench_timer_init(bench_timer_t *t, unsigned long batch)
+{
+	t->samples = NULL;
+	t->n_samples = 0;
+	t->cap = 0;
+	t->batch = batch ? batch : BENCH_BATCH;
+	t->batch_ops = 0;
+	t->widest = 0;
+	t->lost = 0;
+	t->ops = 0;
+	t->ns = 0;
+	t->t0 = 0;
+}
+
+/* ************************************************** */
+
+unsigned long bench_batch_begin(bench_timer_t *t, unsigned long i,
+		unsigned long n)
+{
+	unsigned long end = (n - i > t->batch) ? i + t->batch : n;
+
+	t->batch_ops = end - i;
+	t->t0 = bench_now();
+	return end;
+}
+
+/* ************************************************** */
+/**
+ * The clock is read before growing the sample array, so that cost stays
+ * out of the measure. Without memory for more samples the ones taken are
+ * dropped too, as percentiles of the first part of a run would mislead.
+ */
+void bench_batch_end(bench_timer_t *t)
+{
+	double dt = bench_now() - t->t0;
+	double *grown;
+	unsigned long cap;
+
+	if (t->batch_ops == 0){
+		return;
+	}
+
+	if (!t->lost && t->n_samples == t->cap){
+		cap = t->cap ? t->cap * 2 : 1024;
+		grown = realloc(t->samples, cap * sizeof(double));
+		if (grown == NULL){
+			fprintf(stderr, "bench: out of memory for latency samples, "
+					"percentiles dropped\n");
+			free(t->samples);
+			t->samples = NULL;
+			t->n_samples = 0;
+			t->cap = 0;
+			t->lost = 1;
+		} else {
+			t->samples = grown;
+			t->cap = cap;
+		}
+	}
+
+	if (!t->lost){
+		t->samples[t->n_samples++] = dt / t->batch_ops;
+	}
+	if (t->batch_ops > t->widest){
+		t->widest = t->batch_ops;
+	}
+	t->ops += t->batch_ops;
+	t->ns += dt;
+}
+
+/* ************************************************** */
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* ************************************************** */
+
+void bench_timer_finish(bench_timer_t *t, bench_result_t *r)
+{
+	r->ops = t->ops;
+	r->ns = t->ns;
+	r->p50_batch = -1;
+	r->p99_batch = -1;
+	r->batch = t->widest;
+	r->cpu_ns = -1;
+
+	if (t->n_samples){
+		qsort(t->samples, t->n_samples, sizeof(double), bench_cmp_double);
+		r->p50_batch = t->samples[t->n_samples / 2];
+		r->p99_batch = t->samples[(t->n_samples * 99) / 100];
+	}
+
+	free(t->samples);
+	t->samples = NULL;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file bench.h
+ * @author Juan Manuel Torres Palma
+ * @brief Benchmark harness declaration file
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For int types
+
+#define BENCH_BATCH 64 // Default operations per latency sample
+
+/*
+ * @brief One benchmark measurement, printed as a JSON line.
+ * @var container Name of the container measured.
+ * @var workload Name of the workload.
+ * @var el_size Element size in bytes.
+ * @var n Number of elements the workload keeps in the container.
+ * @var threads Number of threads involved.
+ * @var ops Number of operations timed.
+ * @var ns Total time of those operations.
+ * @var p50_batch Median of the per batch averages of ns per operation.
+ * Negative if not sampled.
+ * @var p99_batch 99th percentile of the same averages. Negative if not
+ * sampled.
+ * @var batch Most operations in a batch the percentiles were taken over.
+ * Only with 1 are they per operation latencies.
+ * @var cpu_ns CPU time burnt by the measured thread. Negative if not
+ * measured.
+ * @var rss_kb Peak resident set size of the process.
+ */
+typedef struct bench_result{
+	const char *container;
+	const char *workload;
+	size_t el_size;
+	unsigned long n;
+	unsigned int threads;
+	unsigned long ops;
+	double ns;
+	double p50_batch;
+	double p99_batch;
+	unsigned long batch;
+	double cpu_ns;
+	long rss_kb;
+} bench_result_t;
+
+/*
+ * @brief Latency sampler. Operations are timed in batches, and every batch
+ * gives one sample of its average time per operation, so the clock cost
+ * is spread over the batch.
+ * @var samples Average ns per operation of each batch.
+ * @var n_samples Number of samples taken.
+ * @var cap Room in samples.
+ * @var batch Operations per batch.
+ * @var batch_ops Operations in the running batch.
+ * @var widest Most operations seen in a batch.
+ * @var lost Set when the samples could not grow. They're dropped and the
+ * percentiles not reported, but ops and ns keep counting.
+ * @var ops Operations timed so far.
+ * @var ns Time spent in batches so far.
+ * @var t0 Start of the running batch.
+ */
+typedef struct bench_timer{
+	double *samples;
+	unsigned long n_samples;
+	unsigned long cap;
+	unsigned long batch;
+	unsigned long batch_ops;
+	unsigned long widest;
+	unsigned char lost;
+	unsigned long ops;
+	double ns;
+	double t0;
+} bench_timer_t;
+
+/*
+ * @brief Monotonic clock.
+ * @return Current time in ns.
+ */
+double bench_now(void);
+
+/*
+ * @brief Peak resident set size of the calling process.
+ * @return Peak RSS in kB.
+ */
+long bench_peak_rss(void);
+
+/*
+ * @brief Prints a result as a single line JSON object on stdout.
+ * @param [in] r Pointer to the result.
+ */
+void bench_print(const bench_result_t *r);
+
+/*
+ * @brief Runs a function in a forked child and waits for it, so that
+ * memory use, peak RSS included, is measured for that run alone.
+ * Kept here because the system headers needed declare their own stack_t.
+ * @param [in] fn Function to run.
+ * @param [in] ctx Argument passed to fn.
+ */
+void bench_run_forked(void (*fn)(void *), void *ctx);
+
+/*
+ * @brief Initialize a timer.
+ * @param [in] t Pointer to the timer.
+ * @param [in] batch Operations per sample. 0 for BENCH_BATCH.
+ */
+void bench_timer_init(bench_timer_t *t, unsigned long batch);
+
+/*
+ * @brief Starts a batch covering operations i to the returned index.
+ * @code
+ * 		for (i = 0; i < n; ){
+ * 			end = bench_batch_begin(&t, i, n);
+ * 			for (; i < end; ++i)
+ * 				stack_push(&s, item);
+ * 			bench_batch_end(&t);
+ * 		}
+ * @endcode
+ * @param [in] t Pointer to the timer.
+ * @param [in] i Index of the first operation of the batch.
+ * @param [in] n Index where the operations end.
+ * @return Index where the batch ends.
+ */
+unsigned long bench_batch_begin(bench_timer_t *t, unsigned long i,
+		unsigned long n);
+
+/*
+ * @brief Closes the running batch and records its sample.
+ * @param [in] t Pointer to the timer.
+ */
+void bench_batch_end(bench_timer_t *t);
+
+/*
+ * @brief Fills ops, ns, p50_batch, p99_batch and batch of a result, marks
+ * cpu_ns as not measured and frees the samples.
+ * @param [in] t Pointer to the timer.
+ * @param [out] r Pointer to the result.
+ */
+void bench_timer_finish(bench_timer_t *t, bench_result_t *r);
+
+/*
+ * @brief Fast reproducible random numbers, xorshift64.
+ * @param [in] state Pointer to the generator state, not 0.
+ * @return Next random number.
+ */
+static inline uint64_t bench_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,189 @@
+#include "queue_mpmc.h"
+#include "queue_batch.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DEFAULT_ITEMS 4000000UL
+#define DEFAULT_THREADS 4
+#define MAX_THREADS 64
+#define MPMC_SLOTS 4096
+#define BATCH_ITEMS 64
+
+/*
+ * Same runs as bench_mpmc, 1 to N producers against as many consumers,
+ * comparing the MPMC queue used item by item against the same queue
+ * behind per thread batches of BATCH_ITEMS. Producers flush when done,
+ * so the last partial batch goes through too. Order and total sum are
+ * checked as in bench_mpmc.
+ */
+
+typedef struct bench_q{
+	unsigned char (*push)(const void *item);
+	unsigned char (*pop)(void *item);
+} bench_q_t;
+
+static unsigned long n_items = DEFAULT_ITEMS;
+static unsigned int n_threads;
+static const bench_q_t *cur_q;
+
+static atomic_ulong popped;
+static atomic_ulong popped_sum;
+
+static queue_mpmc_t mpmc_q;
+static queue_batch_t batch_q;
+static _Thread_local queue_batch_local_t batch_l;
+
+/* ************************************************** */
+
+static unsigned char mpmc_push(const void *item)
+{
+	return queue_mpmc_try_push(&mpmc_q, item);
+}
+
+static unsigned char mpmc_pop(void *item)
+{
+	return queue_mpmc_try_pop(&mpmc_q, item);
+}
+
+static unsigned char batch_push(const void *item)
+{
+	return queue_batch_try_push(&batch_l, item);
+}
+
+static unsigned char batch_pop(void *item)
+{
+	return queue_batch_try_pop(&batch_l, item);
+}
+
+static const bench_q_t mpmc_ops = {mpmc_push, mpmc_pop};
+static const bench_q_t batch_ops = {batch_push, batch_pop};
+
+/* ************************************************** */
+
+static void *producer(void *arg)
+{
+	uint64_t id = (uintptr_t) arg;
+	uint64_t i, v;
+	unsigned long n = n_items / n_threads;
+
+	queue_batch_local_init(&batch_l, &batch_q, 0);
+	for (i = 0; i < n; ++i){
+		v = (id << 40) | i;
+		while (cur_q->push(&v)){
+			sched_yield();
+		}
+	}
+	while (queue_batch_local_release(&batch_l)){
+		sched_yield();
+	}
+
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	uint64_t last[MAX_THREADS];
+	uint64_t v, id, sum = 0;
+	unsigned long total = (n_items / n_threads) * n_threads;
+	unsigned long mine = 0;
+	unsigned int i;
+
+	for (i = 0; i < n_threads; ++i){
+		last[i] = ~0ULL;
+	}
+	queue_batch_local_init(&batch_l, &batch_q, 0);
+
+	/* The shared count is only updated when idle, or it would be the
+	   bottleneck batching is meant to remove */
+	while (atomic_load_explicit(&popped, memory_order_relaxed) < total){
+		if (cur_q->pop(&v)){
+			atomic_fetch_add(&popped, mine);
+			mine = 0;
+			sched_yield();
+			continue;
+		}
+		id = v >> 40;
+		v &= (1ULL << 40) - 1;
+		if (last[id] != ~0ULL && v <= last[id]){
+			fprintf(stderr, "producer %lu out of order\n", (unsigned long) id);
+			exit(1);
+		}
+		last[id] = v;
+		sum += v;
+		++mine;
+	}
+
+	atomic_fetch_add(&popped_sum, sum);
+	queue_batch_local_release(&batch_l);
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void run(const char *name, const bench_q_t *ops)
+{
+	pthread_t prod[MAX_THREADS], cons[MAX_THREADS];
+	unsigned long per = n_items / n_threads;
+	unsigned long total = per * n_threads;
+	bench_result_t r = {"queue", name, sizeof(uint64_t), MPMC_SLOTS,
+			2 * n_threads};
+	unsigned int i;
+	double t;
+
+	cur_q = ops;
+	atomic_store(&popped, 0);
+	atomic_store(&popped_sum, 0);
+
+	t = bench_now();
+	for (i = 0; i < n_threads; ++i){
+		pthread_create(&cons[i], NULL, consumer, NULL);
+		pthread_create(&prod[i], NULL, producer, (void *) (uintptr_t) i);
+	}
+	for (i = 0; i < n_threads; ++i){
+		pthread_join(prod[i], NULL);
+		pthread_join(cons[i], NULL);
+	}
+	t = bench_now() - t;
+
+	if (atomic_load(&popped_sum) != n_threads * (per * (per - 1) / 2)){
+		fprintf(stderr, "%s: lost or duplicated items\n", name);
+		exit(1);
+	}
+
+	r.ops = total;
+	r.ns = t;
+	r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max_threads = DEFAULT_THREADS;
+
+	if (argc > 1){
+		max_threads = strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2){
+		n_items = strtoul(argv[2], NULL, 0);
+	}
+	if (max_threads == 0 || max_threads > MAX_THREADS){
+		max_threads = DEFAULT_THREADS;
+	}
+
+	for (n_threads = 1; n_threads <= max_threads; ++n_threads){
+		queue_mpmc_init(&mpmc_q, sizeof(uint64_t), MPMC_SLOTS);
+		run("mpmc", &mpmc_ops);
+		queue_mpmc_destroy(&mpmc_q);
+
+		queue_batch_init(&batch_q, sizeof(uint64_t), BATCH_ITEMS,
+				MPMC_SLOTS / BATCH_ITEMS);
+		run("batched", &batch_ops);
+		queue_batch_destroy(&batch_q);
+	}
+
+	return 0;
+}
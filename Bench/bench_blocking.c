@@ -0,0 +1,190 @@
+#include "queue.h"
+#include "queue_blocking.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DEFAULT_ROUNDS 100000UL
+#define IDLE_NS 200000000ULL
+
+/*
+ * Two measures of a consumer waiting on a queue, for the blocking queue
+ * and for a mutex guarded queue_t polled with sched_yield:
+ *  - pingpong: a value goes to an echo thread and back through two
+ *    queues, one op per round trip, with p50/p99 per round trip as
+ *    every round trip is a batch of its own.
+ *  - idle: a consumer waits IDLE_NS on an empty queue, a single op whose
+ *    wall time is printed as ns and the CPU time it burns as cpu_ns.
+ */
+
+typedef struct bench_w{
+	void (*push)(int q, uint64_t v);
+	uint64_t (*pop)(int q);
+} bench_w_t;
+
+static unsigned long n_rounds = DEFAULT_ROUNDS;
+static const bench_w_t *cur_w;
+
+static queue_blocking_t blk_q[2];
+
+static queue_t poll_q[2];
+static pthread_mutex_t poll_m[2] = {PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_MUTEX_INITIALIZER};
+
+/* ************************************************** */
+
+static void blk_push(int q, uint64_t v)
+{
+	queue_push_wait(&blk_q[q], &v);
+}
+
+static uint64_t blk_pop(int q)
+{
+	uint64_t v;
+
+	queue_pop_wait(&blk_q[q], &v);
+	return v;
+}
+
+static void poll_push(int q, uint64_t v)
+{
+	pthread_mutex_lock(&poll_m[q]);
+	queue_push_back(&poll_q[q], &v);
+	pthread_mutex_unlock(&poll_m[q]);
+}
+
+static uint64_t poll_pop(int q)
+{
+	uint64_t v;
+	unsigned char got;
+
+	for (;;){
+		pthread_mutex_lock(&poll_m[q]);
+		got = !queue_empty(&poll_q[q]);
+		if (got){
+			queue_pop_front(&poll_q[q], &v);
+		}
+		pthread_mutex_unlock(&poll_m[q]);
+		if (got){
+			return v;
+		}
+		sched_yield();
+	}
+}
+
+static const bench_w_t blk_ops = {blk_push, blk_pop};
+static const bench_w_t poll_ops = {poll_push, poll_pop};
+
+/* ************************************************** */
+
+static double thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *echo(void *arg)
+{
+	uint64_t v;
+
+	do {
+		v = cur_w->pop(0);
+		cur_w->push(1, v);
+	} while (v != ~0ULL);
+
+	return NULL;
+}
+
+static void *idle_consumer(void *arg)
+{
+	double *cpu = arg;
+
+	*cpu = thread_cpu_ns();
+	cur_w->pop(0);
+	*cpu = thread_cpu_ns() - *cpu;
+
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void run(const char *name, const bench_w_t *ops)
+{
+	bench_result_t r = {"queue", "pingpong", sizeof(uint64_t), 1, 2};
+	struct timespec idle = {IDLE_NS / 1000000000ULL,
+			IDLE_NS % 1000000000ULL};
+	bench_timer_t t;
+	pthread_t th;
+	unsigned long i;
+	double cpu, wall;
+	char workload[32];
+
+	cur_w = ops;
+
+	pthread_create(&th, NULL, echo, NULL);
+	bench_timer_init(&t, 1);
+	for (i = 0; i < n_rounds; ){
+		bench_batch_begin(&t, i, i + 1);
+		ops->push(0, i);
+		if (ops->pop(1) != i){
+			fprintf(stderr, "%s: echo mismatch\n", name);
+			exit(1);
+		}
+		++i;
+		bench_batch_end(&t);
+	}
+	ops->push(0, ~0ULL);
+	ops->pop(1);
+	pthread_join(th, NULL);
+
+	snprintf(workload, sizeof(workload), "%s_pingpong", name);
+	r.workload = workload;
+	bench_timer_finish(&t, &r);
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+
+	wall = bench_now();
+	pthread_create(&th, NULL, idle_consumer, &cpu);
+	nanosleep(&idle, NULL);
+	ops->push(0, 0);
+	pthread_join(th, NULL);
+	wall = bench_now() - wall;
+
+	snprintf(workload, sizeof(workload), "%s_idle", name);
+	r.n = 0;
+	r.ops = 1;
+	r.ns = wall;
+	r.p50_batch = r.p99_batch = -1;
+	r.cpu_ns = cpu;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i;
+
+	if (argc > 1){
+		n_rounds = strtoul(argv[1], NULL, 0);
+	}
+
+	for (i = 0; i < 2; ++i){
+		queue_blocking_init(&blk_q[i], sizeof(uint64_t), 0);
+		queue_init(&poll_q[i], sizeof(uint64_t));
+	}
+
+	run("blocking", &blk_ops);
+	run("polled", &poll_ops);
+
+	for (i = 0; i < 2; ++i){
+		queue_blocking_destroy(&blk_q[i]);
+		queue_destroy(&poll_q[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+#include "stack.h"
+#include "stack_lf.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DEFAULT_ITEMS 4000000UL
+#define DEFAULT_THREADS 4
+#define MAX_THREADS 64
+#define LIFO_BATCH 64
+
+/*
+ * Runs 1 to N threads using the same stack as a free-object pool: each one
+ * pushes a batch of its own items and then pops as many, getting any
+ * thread's items back. Items carry the thread id in the high bits and a
+ * counter in the low ones, and the count and sum of the popped items are
+ * checked against the pushed ones at the end, so a lost or duplicated
+ * item makes the run fail.
+ */
+
+typedef struct bench_s{
+	unsigned char (*push)(const void *item);
+	unsigned char (*pop)(void *item);
+} bench_s_t;
+
+static unsigned long n_items = DEFAULT_ITEMS;
+static unsigned int n_threads;
+static const bench_s_t *cur_s;
+
+static atomic_ulong popped;
+static atomic_ulong popped_sum;
+
+static stack_lf_t lf_s;
+
+static stack_t locked_s;
+static pthread_mutex_t locked_m = PTHREAD_MUTEX_INITIALIZER;
+
+/* ************************************************** */
+
+static unsigned char lf_push(const void *item)
+{
+	return stack_lf_try_push(&lf_s, item);
+}
+
+static unsigned char lf_pop(void *item)
+{
+	return stack_lf_try_pop(&lf_s, item);
+}
+
+static unsigned char locked_push(const void *item)
+{
+	unsigned char full;
+
+	pthread_mutex_lock(&locked_m);
+	full = stack_push(&locked_s, (void *) item);
+	pthread_mutex_unlock(&locked_m);
+	return full;
+}
+
+static unsigned char locked_pop(void *item)
+{
+	unsigned char empty;
+
+	pthread_mutex_lock(&locked_m);
+	empty = stack_empty(&locked_s);
+	if (!empty){
+		stack_pop(&locked_s, item);
+	}
+	pthread_mutex_unlock(&locked_m);
+	return empty;
+}
+
+static const bench_s_t lf_ops = {lf_push, lf_pop};
+static const bench_s_t locked_ops = {locked_push, locked_pop};
+
+/* ************************************************** */
+
+static void *worker(void *arg)
+{
+	uint64_t id = (uintptr_t) arg;
+	uint64_t i, b, v, sum = 0;
+	unsigned long n = n_items / n_threads;
+
+	for (i = 0; i < n; i += LIFO_BATCH){
+		for (b = i; b < i + LIFO_BATCH && b < n; ++b){
+			v = (id << 40) | b;
+			while (cur_s->push(&v)){
+				sched_yield();
+			}
+		}
+		for (b = i; b < i + LIFO_BATCH && b < n; ++b){
+			while (cur_s->pop(&v)){
+				sched_yield();
+			}
+			sum += v;
+		}
+	}
+
+	atomic_fetch_add(&popped, n);
+	atomic_fetch_add(&popped_sum, sum);
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void run(const char *name, const bench_s_t *ops)
+{
+	pthread_t th[MAX_THREADS];
+	unsigned long per = n_items / n_threads;
+	uint64_t sum = 0;
+	bench_result_t r = {"stack", name, sizeof(uint64_t),
+			LIFO_BATCH * n_threads, n_threads};
+	unsigned int i;
+	double t;
+
+	cur_s = ops;
+	atomic_store(&popped, 0);
+	atomic_store(&popped_sum, 0);
+
+	t = bench_now();
+	for (i = 0; i < n_threads; ++i){
+		pthread_create(&th[i], NULL, worker, (void *) (uintptr_t) i);
+	}
+	for (i = 0; i < n_threads; ++i){
+		pthread_join(th[i], NULL);
+	}
+	t = bench_now() - t;
+
+	for (i = 0; i < n_threads; ++i){
+		sum += ((uint64_t) i << 40) * per + per * (per - 1) / 2;
+	}
+	if (atomic_load(&popped) != per * n_threads ||
+			atomic_load(&popped_sum) != sum){
+		fprintf(stderr, "%s: lost or duplicated items\n", name);
+		exit(1);
+	}
+
+	/* A push and a pop per item */
+	r.ops = 2 * per * n_threads;
+	r.ns = t;
+	r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max_threads = DEFAULT_THREADS;
+
+	if (argc > 1){
+		max_threads = strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2){
+		n_items = strtoul(argv[2], NULL, 0);
+	}
+	if (max_threads == 0 || max_threads > MAX_THREADS){
+		max_threads = DEFAULT_THREADS;
+	}
+
+	for (n_threads = 1; n_threads <= max_threads; ++n_threads){
+		stack_lf_init(&lf_s, sizeof(uint64_t), LIFO_BATCH * n_threads);
+		run("treiber", &lf_ops);
+		stack_lf_destroy(&lf_s);
+
+		stack_init_capacity(&locked_s, sizeof(uint64_t),
+				LIFO_BATCH * n_threads);
+		run("locked", &locked_ops);
+		stack_destroy(&locked_s);
+	}
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include "queue.h"
+#include "queue_mpmc.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DEFAULT_ITEMS 4000000UL
+#define DEFAULT_THREADS 4
+#define MAX_THREADS 64
+#define MPMC_SLOTS 4096
+
+/*
+ * Runs 1 to N producers against the same number of consumers. Items carry
+ * the producer id in the high bits and a counter in the low ones, so each
+ * consumer checks that every producer's items arrive in order and the
+ * total sum is checked at the end.
+ */
+
+typedef struct bench_q{
+	unsigned char (*push)(const void *item);
+	unsigned char (*pop)(void *item);
+} bench_q_t;
+
+static unsigned long n_items = DEFAULT_ITEMS;
+static unsigned int n_threads;
+static const bench_q_t *cur_q;
+
+static atomic_ulong popped;
+static atomic_ulong popped_sum;
+
+static queue_mpmc_t mpmc_q;
+
+static queue_t locked_q;
+static pthread_mutex_t locked_m = PTHREAD_MUTEX_INITIALIZER;
+
+/* ************************************************** */
+
+static unsigned char mpmc_push(const void *item)
+{
+	return queue_mpmc_try_push(&mpmc_q, item);
+}
+
+static unsigned char mpmc_pop(void *item)
+{
+	return queue_mpmc_try_pop(&mpmc_q, item);
+}
+
+static unsigned char locked_push(const void *item)
+{
+	pthread_mutex_lock(&locked_m);
+	queue_push_back(&locked_q, (void *) item);
+	pthread_mutex_unlock(&locked_m);
+	return 0;
+}
+
+static unsigned char locked_pop(void *item)
+{
+	unsigned char empty;
+
+	pthread_mutex_lock(&locked_m);
+	empty = queue_empty(&locked_q);
+	if (!empty){
+		queue_pop_front(&locked_q, item);
+	}
+	pthread_mutex_unlock(&locked_m);
+	return empty;
+}
+
+static const bench_q_t mpmc_ops = {mpmc_push, mpmc_pop};
+static const bench_q_t locked_ops = {locked_push, locked_pop};
+
+/* ************************************************** */
+
+static void *producer(void *arg)
+{
+	uint64_t id = (uintptr_t) arg;
+	uint64_t i, v;
+	unsigned long n = n_items / n_threads;
+
+	for (i = 0; i < n; ++i){
+		v = (id << 40) | i;
+		while (cur_q->push(&v)){
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	uint64_t last[MAX_THREADS];
+	uint64_t v, id, sum = 0;
+	unsigned long total = (n_items / n_threads) * n_threads;
+	unsigned int i;
+
+	for (i = 0; i < n_threads; ++i){
+		last[i] = ~0ULL;
+	}
+
+	while (atomic_load(&popped) < total){
+		if (cur_q->pop(&v)){
+			sched_yield();
+			continue;
+		}
+		id = v >> 40;
+		v &= (1ULL << 40) - 1;
+		if (last[id] != ~0ULL && v <= last[id]){
+			fprintf(stderr, "producer %lu out of order\n", (unsigned long) id);
+			exit(1);
+		}
+		last[id] = v;
+		sum += v;
+		atomic_fetch_add(&popped, 1);
+	}
+
+	atomic_fetch_add(&popped_sum, sum);
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void run(const char *name, const bench_q_t *ops)
+{
+	pthread_t prod[MAX_THREADS], cons[MAX_THREADS];
+	unsigned long per = n_items / n_threads;
+	unsigned long total = per * n_threads;
+	bench_result_t r = {"queue", name, sizeof(uint64_t), MPMC_SLOTS,
+			2 * n_threads};
+	unsigned int i;
+	double t;
+
+	cur_q = ops;
+	atomic_store(&popped, 0);
+	atomic_store(&popped_sum, 0);
+
+	t = bench_now();
+	for (i = 0; i < n_threads; ++i){
+		pthread_create(&cons[i], NULL, consumer, NULL);
+		pthread_create(&prod[i], NULL, producer, (void *) (uintptr_t) i);
+	}
+	for (i = 0; i < n_threads; ++i){
+		pthread_join(prod[i], NULL);
+		pthread_join(cons[i], NULL);
+	}
+	t = bench_now() - t;
+
+	if (atomic_load(&popped_sum) != n_threads * (per * (per - 1) / 2)){
+		fprintf(stderr, "%s: lost or duplicated items\n", name);
+		exit(1);
+	}
+
+	r.ops = total;
+	r.ns = t;
+	r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max_threads = DEFAULT_THREADS;
+
+	if (argc > 1){
+		max_threads = strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2){
+		n_items = strtoul(argv[2], NULL, 0);
+	}
+	if (max_threads == 0 || max_threads > MAX_THREADS){
+		max_threads = DEFAULT_THREADS;
+	}
+
+	for (n_threads = 1; n_threads <= max_threads; ++n_threads){
+		queue_mpmc_init(&mpmc_q, sizeof(uint64_t), MPMC_SLOTS);
+		run("mpmc", &mpmc_ops);
+		queue_mpmc_destroy(&mpmc_q);
+
+		queue_init(&locked_q, sizeof(uint64_t));
+		run("locked", &locked_ops);
+		queue_destroy(&locked_q);
+	}
+
+	return 0;
+}
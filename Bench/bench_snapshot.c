@@ -0,0 +1,283 @@
+#include "stack.h"
+#include "queue.h"
+#include "list.h"
+#include "snapshot.h"
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DEFAULT_ELEMENTS 10000000UL // Elements moved per workload
+
+/*
+ * Checkpoint and restart: each container of n elements is saved to a
+ * file and loaded back, over and over, with *_save and *_load. The
+ * file stays in the page cache, so this is the ceiling set by the copies
+ * and system calls, not by the disk. list/load_push is the walk a caller
+ * does without list_load: read the elements and list_push_back each one.
+ * An op is one element.
+ */
+
+static const size_t el_sizes[] = {8, 64};
+static const unsigned long sizes[] = {10000, 1000000};
+
+static unsigned long elements = DEFAULT_ELEMENTS;
+static char path[256];
+static unsigned char item[64];
+
+typedef struct snap_w{
+	const char *container;
+	const char *workload;
+	double (*run)(size_t el_size, unsigned long n, unsigned long reps);
+} snap_w_t;
+
+/* ************************************************** */
+
+static int open_trunc(void)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0){
+		fprintf(stderr, "bench_snapshot: can't open %s\n", path);
+		exit(1);
+	}
+
+	return fd;
+}
+
+static void check(unsigned char failed, const char *what)
+{
+	if (failed){
+		fprintf(stderr, "bench_snapshot: %s failed\n", what);
+		exit(1);
+	}
+}
+
+/* ************************************************** */
+
+static double stack_save_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	stack_t s;
+	int fd;
+
+	stack_init_capacity(&s, el_size, n);
+	for (i = 0; i < n; ++i){
+		stack_push(&s, item);
+	}
+
+	for (i = 0; i < reps; ++i){
+		fd = open_trunc();
+		t0 = bench_now();
+		check(stack_save(&s, fd), "stack_save");
+		ns += bench_now() - t0;
+		close(fd);
+	}
+
+	stack_destroy(&s);
+	return ns;
+}
+
+static double stack_load_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	stack_t s;
+	int fd = open(path, O_RDONLY);
+
+	for (i = 0; i < reps; ++i){
+		lseek(fd, 0, SEEK_SET);
+		t0 = bench_now();
+		check(stack_load(&s, fd), "stack_load");
+		ns += bench_now() - t0;
+		stack_destroy(&s);
+	}
+
+	close(fd);
+	return ns;
+}
+
+/* ************************************************** */
+
+static double queue_save_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	queue_t q;
+	int fd;
+
+	/* Half way round the ring, so the save takes two segments */
+	queue_init_capacity(&q, el_size, n);
+	for (i = 0; i < q.max_size / 2; ++i){
+		queue_push_back(&q, item);
+		queue_pop_front(&q, NULL);
+	}
+	for (i = 0; i < n; ++i){
+		queue_push_back(&q, item);
+	}
+
+	for (i = 0; i < reps; ++i){
+		fd = open_trunc();
+		t0 = bench_now();
+		check(queue_save(&q, fd), "queue_save");
+		ns += bench_now() - t0;
+		close(fd);
+	}
+
+	queue_destroy(&q);
+	return ns;
+}
+
+static double queue_load_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	queue_t q;
+	int fd = open(path, O_RDONLY);
+
+	for (i = 0; i < reps; ++i){
+		lseek(fd, 0, SEEK_SET);
+		t0 = bench_now();
+		check(queue_load(&q, fd), "queue_load");
+		ns += bench_now() - t0;
+		queue_destroy(&q);
+	}
+
+	close(fd);
+	return ns;
+}
+
+/* ************************************************** */
+
+static double list_save_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	list_t l;
+	int fd;
+
+	list_init(&l, el_size);
+	for (i = 0; i < n; ++i){
+		list_push_back(&l, item);
+	}
+
+	for (i = 0; i < reps; ++i){
+		fd = open_trunc();
+		t0 = bench_now();
+		check(list_save(&l, fd), "list_save");
+		ns += bench_now() - t0;
+		close(fd);
+	}
+
+	list_destroy(&l);
+	return ns;
+}
+
+static double list_load_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i;
+	double ns = 0, t0;
+	list_t l;
+	int fd = open(path, O_RDONLY);
+
+	for (i = 0; i < reps; ++i){
+		lseek(fd, 0, SEEK_SET);
+		t0 = bench_now();
+		check(list_load(&l, fd), "list_load");
+		ns += bench_now() - t0;
+		list_destroy(&l);
+	}
+
+	close(fd);
+	return ns;
+}
+
+/*
+ * The whole file is read in one go, so only the pushes differ from
+ * list_load.
+ */
+static double list_load_push_w(size_t el_size, unsigned long n,
+		unsigned long reps)
+{
+	unsigned long i, k;
+	double ns = 0, t0;
+	snap_header_t hdr;
+	struct iovec iov;
+	unsigned char *buf = malloc(el_size * n);
+	list_t l;
+	int fd = open(path, O_RDONLY);
+
+	for (i = 0; i < reps; ++i){
+		lseek(fd, 0, SEEK_SET);
+		t0 = bench_now();
+		check(snap_read_header(fd, &hdr), "snap_read_header");
+		iov.iov_base = buf;
+		iov.iov_len = hdr.el_size * hdr.count;
+		check(snap_readv(fd, &iov, 1), "snap_readv");
+		list_init(&l, hdr.el_size);
+		for (k = 0; k < hdr.count; ++k){
+			list_push_back(&l, buf + hdr.el_size * k);
+		}
+		ns += bench_now() - t0;
+		list_destroy(&l);
+	}
+
+	free(buf);
+	close(fd);
+	return ns;
+}
+
+/* ************************************************** */
+
+/* Every load reads the file the save before it left */
+static const snap_w_t workloads[] = {
+	{"stack", "save", stack_save_w},
+	{"stack", "load", stack_load_w},
+	{"queue", "save", queue_save_w},
+	{"queue", "load", queue_load_w},
+	{"list", "save", list_save_w},
+	{"list", "load", list_load_w},
+	{"list", "load_push", list_load_push_w},
+};
+
+int main(int argc, char *argv[])
+{
+	bench_result_t r = {NULL, NULL, 0, 0, 1};
+	unsigned long reps;
+	unsigned int e, n, w;
+
+	if (argc > 1){
+		elements = strtoul(argv[1], NULL, 0);
+	}
+
+	snprintf(path, sizeof(path), "%s/bench_snapshot.%d",
+			(argc > 2) ? argv[2] : "/tmp", (int) getpid());
+
+	for (e = 0; e < sizeof(el_sizes) / sizeof(el_sizes[0]); ++e){
+		for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); ++n){
+			reps = elements / sizes[n] ? elements / sizes[n] : 1;
+			for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w){
+				r.container = workloads[w].container;
+				r.workload = workloads[w].workload;
+				r.el_size = el_sizes[e];
+				r.n = sizes[n];
+				r.ops = sizes[n] * reps;
+				r.ns = workloads[w].run(el_sizes[e], sizes[n], reps);
+				r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+				r.rss_kb = bench_peak_rss();
+				bench_print(&r);
+			}
+		}
+	}
+
+	unlink(path);
+	return 0;
+}
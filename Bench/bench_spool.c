@@ -0,0 +1,155 @@
+#include "queue.h"
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DEFAULT_OPS 2000000UL
+#define SPOOL_ITEMS 65536 // Items spooled before draining
+#define SYNC_EVERY 4096 // Pushes between durability points
+
+/*
+ * Sustained spooling to disk, SPOOL_ITEMS events pushed and then drained,
+ * over and over, through:
+ *  - mmap: a file backed queue_t, queue_push_back and queue_pop_front.
+ *  - write: an append only file, write() per event and read() back.
+ * The _sync variants add a durability point every SYNC_EVERY pushes,
+ * queue_sync against fdatasync. An op is one push or one pop.
+ */
+
+static const size_t el_sizes[] = {64, 256};
+
+static unsigned long ops_budget = DEFAULT_OPS;
+static const char *dir = "/tmp";
+static unsigned char item[256];
+
+/* ************************************************** */
+
+static void spool_mmap(bench_timer_t *t, const char *path, size_t el_size,
+		unsigned char sync)
+{
+	unsigned long i, end, r, rounds = ops_budget / (2 * SPOOL_ITEMS);
+	queue_t q;
+
+	if (queue_open_file(&q, path, el_size, SPOOL_ITEMS)){
+		fprintf(stderr, "bench_spool: can't map %s\n", path);
+		exit(1);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < SPOOL_ITEMS; ){
+			end = bench_batch_begin(t, i, SPOOL_ITEMS);
+			for (; i < end; ++i){
+				memcpy(item, &i, sizeof(i));
+				queue_push_back(&q, item);
+				if (sync && (i + 1) % SYNC_EVERY == 0){
+					queue_sync(&q);
+				}
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < SPOOL_ITEMS; ){
+			end = bench_batch_begin(t, i, SPOOL_ITEMS);
+			for (; i < end; ++i){
+				queue_pop_front(&q, item);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	queue_destroy(&q);
+}
+
+/* ************************************************** */
+
+static void spool_write(bench_timer_t *t, const char *path, size_t el_size,
+		unsigned char sync)
+{
+	unsigned long i, end, r, rounds = ops_budget / (2 * SPOOL_ITEMS);
+	int wfd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	int rfd = open(path, O_RDONLY);
+
+	if (wfd < 0 || rfd < 0){
+		fprintf(stderr, "bench_spool: can't open %s\n", path);
+		exit(1);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < SPOOL_ITEMS; ){
+			end = bench_batch_begin(t, i, SPOOL_ITEMS);
+			for (; i < end; ++i){
+				memcpy(item, &i, sizeof(i));
+				if (write(wfd, item, el_size) != (ssize_t) el_size){
+					exit(1);
+				}
+				if (sync && (i + 1) % SYNC_EVERY == 0){
+					fdatasync(wfd);
+				}
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < SPOOL_ITEMS; ){
+			end = bench_batch_begin(t, i, SPOOL_ITEMS);
+			for (; i < end; ++i){
+				if (read(rfd, item, el_size) != (ssize_t) el_size){
+					exit(1);
+				}
+			}
+			bench_batch_end(t);
+		}
+		/* Drained, start the file over like a spool would */
+		if (ftruncate(wfd, 0) < 0){
+			exit(1);
+		}
+		lseek(wfd, 0, SEEK_SET);
+		lseek(rfd, 0, SEEK_SET);
+	}
+
+	close(wfd);
+	close(rfd);
+}
+
+/* ************************************************** */
+
+int main(int argc, char *argv[])
+{
+	static const char *names[] = {"spool_write", "spool_mmap",
+			"spool_write_sync", "spool_mmap_sync"};
+	bench_result_t r = {"queue", NULL, 0, SPOOL_ITEMS, 1};
+	bench_timer_t t;
+	char path[256];
+	unsigned int i, w;
+
+	if (argc > 1){
+		ops_budget = strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2){
+		dir = argv[2];
+	}
+	if (ops_budget < 2 * SPOOL_ITEMS){
+		ops_budget = 2 * SPOOL_ITEMS;
+	}
+
+	snprintf(path, sizeof(path), "%s/bench_spool.%d", dir, (int) getpid());
+
+	for (i = 0; i < sizeof(el_sizes) / sizeof(el_sizes[0]); ++i){
+		for (w = 0; w < 4; ++w){
+			unlink(path);
+			bench_timer_init(&t, 0);
+			if (w & 1){
+				spool_mmap(&t, path, el_sizes[i], w >> 1);
+			} else {
+				spool_write(&t, path, el_sizes[i], w >> 1);
+			}
+			r.workload = names[w];
+			r.el_size = el_sizes[i];
+			bench_timer_finish(&t, &r);
+			r.rss_kb = bench_peak_rss();
+			bench_print(&r);
+		}
+	}
+
+	unlink(path);
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include "queue.h"
+#include "queue_spsc.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DEFAULT_ITEMS 10000000UL
+#define SPSC_SLOTS 1024
+
+/*
+ * Producer sends a counter, consumer checks it arrives in order, so the
+ * benchmark doubles as a stress test of both queues.
+ */
+
+static unsigned long n_items = DEFAULT_ITEMS;
+
+static queue_spsc_t spsc_q;
+
+static queue_t locked_q;
+static pthread_mutex_t locked_m = PTHREAD_MUTEX_INITIALIZER;
+
+/* ************************************************** */
+
+static void *spsc_producer(void *arg)
+{
+	uint64_t i;
+
+	for (i = 0; i < n_items; ++i){
+		while (queue_spsc_try_push(&spsc_q, &i)){
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void *spsc_consumer(void *arg)
+{
+	uint64_t i, v;
+
+	for (i = 0; i < n_items; ++i){
+		while (queue_spsc_try_pop(&spsc_q, &v)){
+			sched_yield();
+		}
+		if (v != i){
+			fprintf(stderr, "spsc: expected %lu got %lu\n",
+					(unsigned long) i, (unsigned long) v);
+			exit(1);
+		}
+	}
+
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void *locked_producer(void *arg)
+{
+	uint64_t i;
+
+	for (i = 0; i < n_items; ++i){
+		pthread_mutex_lock(&locked_m);
+		queue_push_back(&locked_q, &i);
+		pthread_mutex_unlock(&locked_m);
+	}
+
+	return NULL;
+}
+
+static void *locked_consumer(void *arg)
+{
+	uint64_t i = 0, v;
+	unsigned int got;
+
+	while (i < n_items){
+		pthread_mutex_lock(&locked_m);
+		got = !queue_empty(&locked_q);
+		if (got){
+			queue_pop_front(&locked_q, &v);
+		}
+		pthread_mutex_unlock(&locked_m);
+
+		if (!got){
+			sched_yield();
+			continue;
+		}
+		if (v != i){
+			fprintf(stderr, "locked: expected %lu got %lu\n",
+					(unsigned long) i, (unsigned long) v);
+			exit(1);
+		}
+		++i;
+	}
+
+	return NULL;
+}
+
+/* ************************************************** */
+
+static void run(const char *name, void *(*prod)(void *),
+		void *(*cons)(void *))
+{
+	pthread_t p, c;
+	bench_result_t r = {"queue", name, sizeof(uint64_t), SPSC_SLOTS, 2};
+	double t = bench_now();
+
+	pthread_create(&c, NULL, cons, NULL);
+	pthread_create(&p, NULL, prod, NULL);
+	pthread_join(p, NULL);
+	pthread_join(c, NULL);
+
+	r.ops = n_items;
+	r.ns = bench_now() - t;
+	r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1){
+		n_items = strtoul(argv[1], NULL, 0);
+	}
+
+	queue_spsc_init(&spsc_q, sizeof(uint64_t), SPSC_SLOTS);
+	run("spsc", spsc_producer, spsc_consumer);
+	queue_spsc_destroy(&spsc_q);
+
+	queue_init(&locked_q, sizeof(uint64_t));
+	run("locked", locked_producer, locked_consumer);
+	queue_destroy(&locked_q);
+
+	return 0;
+}
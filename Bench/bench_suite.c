@@ -0,0 +1,1301 @@
+#include "bench.h"
+#include "stack.h"
+#include "queue.h"
+#include "list.h"
+#include "ulist.h"
+#include "ilist.h"
+#include "deque.h"
+#include "pq.h"
+#include "find.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h> /* For getopt */
+
+/*
+ * Standard workloads over the containers, for every element size and
+ * container size from min_n to max_n in powers of 10. Each case runs in a
+ * forked child so the peak RSS reported belongs to that case alone, and
+ * the random generator is reseeded per case so runs are reproducible.
+ *
+ * An op is one container call, except for fifo, where it's a push and a
+ * pop that keep the size constant, for traverse, where it's one element
+ * visited, for rebalance and sort, where it's one element moved or
+ * sorted, and for find, search and random_ins_del, where it's a whole
+ * search or positioned insert/delete, iterator walk included. Elements
+ * carry a 32 bit key in their first bytes, truncated for elements smaller
+ * than that.
+ *
+ * Usage: bench_suite [-n max_n] [-m min_n] [-o ops] [-s seed] [-w filter]
+ * where filter is matched against "container/workload".
+ */
+
+#define DEFAULT_MIN_N 100UL
+#define DEFAULT_MAX_N 1000000UL
+#define DEFAULT_OPS 2000000UL
+#define DEFAULT_SEED 88172645463325252ULL
+#define MAX_EL_SIZE 256
+
+typedef void (*workload_fn_t)(bench_timer_t *t, size_t el_size,
+		unsigned long n);
+
+/*
+ * @brief A named workload.
+ * @var container Name of the container used.
+ * @var name Name of the workload.
+ * @var run Function running it.
+ * @var max_n Biggest container size worth running. 0 for no limit.
+ */
+typedef struct workload{
+	const char *container;
+	const char *name;
+	workload_fn_t run;
+	unsigned long max_n;
+} workload_t;
+
+static const size_t el_sizes[] = {1, 8, 64, 256};
+
+static unsigned long ops_budget = DEFAULT_OPS;
+static uint64_t rng;
+
+static unsigned char item[MAX_EL_SIZE];
+static unsigned char out[MAX_EL_SIZE];
+
+/* ************************************************** */
+
+static void set_key(unsigned char *it, size_t el_size, uint32_t key)
+{
+	memset(it, 0, el_size);
+	memcpy(it, &key, el_size < sizeof(key) ? el_size : sizeof(key));
+}
+
+static unsigned long rounds_for(unsigned long ops_per_round)
+{
+	unsigned long r = ops_budget / ops_per_round;
+
+	return r ? r : 1;
+}
+
+/*
+ * @brief Sum of the first byte of keys 0 to n - 1, the value a traversal
+ * must add up to.
+ */
+static unsigned long key_sum(size_t el_size, unsigned long n)
+{
+	unsigned long i, sum = 0;
+
+	for (i = 0; i < n; ++i){
+		sum += i & 0xff;
+	}
+
+	return sum;
+}
+
+/* ************************************************** */
+
+static void stack_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	stack_t s;
+
+	stack_init(&s, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){ /* Warm up, grows the buffer */
+		stack_push(&s, item);
+	}
+	stack_pop_n(&s, NULL, n);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				stack_push(&s, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				stack_pop(&s, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	stack_destroy(&s);
+}
+
+static void stack_growth(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	stack_t s;
+
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		stack_init(&s, el_size);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				stack_push(&s, item);
+			}
+			bench_batch_end(t);
+		}
+		stack_destroy(&s);
+	}
+}
+
+/*
+ * Keys are 0 to n - 1 from the bottom, and the searched ones uniform, so a
+ * hit scans half the stack on average. Same as list/search over an array.
+ */
+static void stack_find_scan(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = rounds_for(n / 2 + 1);
+	stack_t s;
+
+	stack_init(&s, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		stack_push(&s, item);
+	}
+
+	for (i = 0; i < searches; ){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		end = bench_batch_begin(t, i, i + 1);
+		for (; i < end; ++i){
+			if (stack_find(&s, item) == NULL){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	stack_destroy(&s);
+}
+
+/*
+ * Same searches as stack/find, one memcmp per element. The baseline the
+ * vector kernels are measured against.
+ */
+static void stack_find_scalar(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = rounds_for(n / 2 + 1);
+	stack_t s;
+
+	stack_init(&s, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		stack_push(&s, item);
+	}
+
+	for (i = 0; i < searches; ){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		end = bench_batch_begin(t, i, i + 1);
+		for (; i < end; ++i){
+			if (elm_find_scalar(s.data, n, el_size, item) == n){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	stack_destroy(&s);
+}
+
+/* ************************************************** */
+
+static void queue_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	queue_t q;
+
+	queue_init(&q, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		queue_push_back(&q, item);
+	}
+	queue_pop_n(&q, NULL, n);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				queue_push_back(&q, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				queue_pop_front(&q, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	queue_destroy(&q);
+}
+
+static void queue_fifo(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, pairs = ops_budget / 2;
+	queue_t q;
+
+	queue_init(&q, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		queue_push_back(&q, item);
+	}
+
+	for (i = 0; i < pairs; ){
+		end = bench_batch_begin(t, i, pairs);
+		for (; i < end; ++i){
+			queue_push_back(&q, item);
+			queue_pop_front(&q, out);
+		}
+		bench_batch_end(t);
+	}
+
+	queue_destroy(&q);
+}
+
+/*
+ * Same searches as stack/find, with the items rotated half way around the
+ * ring so both spans get scanned.
+ */
+static void queue_find_scan(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = rounds_for(n / 2 + 1);
+	queue_t q;
+
+	queue_init_capacity(&q, el_size, n);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		queue_push_back(&q, item);
+	}
+	for (i = 0; i < n / 2; ++i){
+		queue_pop_front(&q, item);
+		queue_push_back(&q, item);
+	}
+
+	for (i = 0; i < searches; ){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		end = bench_batch_begin(t, i, i + 1);
+		for (; i < end; ++i){
+			if (queue_find(&q, item) == NULL){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	queue_destroy(&q);
+}
+
+static void queue_growth(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	queue_t q;
+
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		queue_init(&q, el_size);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				queue_push_back(&q, item);
+			}
+			bench_batch_end(t);
+		}
+		queue_destroy(&q);
+	}
+}
+
+/* ************************************************** */
+
+static void list_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	list_t l;
+
+	list_init(&l, el_size);
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				list_push_back(&l, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				list_pop_front(&l, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	list_destroy(&l);
+}
+
+static void list_fifo(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, pairs = ops_budget / 2;
+	list_t l;
+
+	list_init(&l, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		list_push_back(&l, item);
+	}
+
+	for (i = 0; i < pairs; ){
+		end = bench_batch_begin(t, i, pairs);
+		for (; i < end; ++i){
+			list_push_back(&l, item);
+			list_pop_front(&l, out);
+		}
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l);
+}
+
+/*
+ * Walks the whole list with an iterator, reading every element.
+ */
+static void list_traverse(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	list_iterator_t it;
+	unsigned long sum = 0;
+	list_t l;
+
+	list_init(&l, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		list_push_back(&l, item);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		it = list_begin(&l);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				sum += *(unsigned char *) list_iterator_data(it);
+				it = list_iterator_advance(it);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	if (sum != rounds * key_sum(el_size, n)){
+		abort();
+	}
+
+	list_destroy(&l);
+}
+
+/*
+ * Keys are 0 to n - 1 in order, and the searched ones are uniform, so a
+ * hit scans half the list on average.
+ */
+static void list_search_scan(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = rounds_for(n / 2 + 1);
+	list_t l;
+
+	list_init(&l, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		list_push_back(&l, item);
+	}
+
+	for (i = 0; i < searches; ){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		end = bench_batch_begin(t, i, i + 1);
+		for (; i < end; ++i){
+			if (list_search(&l, item) == NULL){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l);
+}
+
+static size_t key_el_size;
+
+static size_t key_hash(const void *it)
+{
+	uint32_t key = 0;
+
+	memcpy(&key, it, key_el_size < sizeof(key) ? key_el_size : sizeof(key));
+	return key * 2654435761UL;
+}
+
+static int key_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, key_el_size < sizeof(uint32_t) ?
+			key_el_size : sizeof(uint32_t));
+}
+
+/*
+ * @brief Orders elements by their key as a number, smallest first.
+ */
+static int key_order(const void *a, const void *b)
+{
+	uint32_t ka = 0, kb = 0;
+	size_t len = key_el_size < sizeof(ka) ? key_el_size : sizeof(ka);
+
+	memcpy(&ka, a, len);
+	memcpy(&kb, b, len);
+	return (ka > kb) - (ka < kb);
+}
+
+/*
+ * Same keys and searches as list/search, through the hash index.
+ */
+static void list_lookup_index(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = ops_budget / 2;
+	list_t l;
+
+	list_init(&l, el_size);
+	key_el_size = el_size;
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		list_push_back(&l, item);
+	}
+	list_index_init(&l, key_hash, key_cmp);
+
+	for (i = 0; i < searches; ){
+		end = bench_batch_begin(t, i, searches);
+		for (; i < end; ++i){
+			set_key(item, el_size, bench_rand(&rng) % n);
+			if (list_lookup(&l, item) == NULL){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l);
+}
+
+/*
+ * Walks an iterator to a random position from the closest end and
+ * alternates inserting there and deleting it, so the size stays around n.
+ */
+static void list_random_ins_del(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, k, pos, steps = rounds_for(n / 4 + 1) * 4;
+	list_iterator_t it;
+	list_t l;
+
+	list_init(&l, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		list_push_back(&l, item);
+	}
+
+	for (i = 0; i < steps; ){
+		pos = bench_rand(&rng) % list_size(&l);
+		bench_batch_begin(t, i, i + 1);
+
+		if (pos < list_size(&l) / 2){
+			it = list_begin(&l);
+			for (k = 0; k < pos; ++k){
+				it = list_iterator_advance(it);
+			}
+		} else {
+			it = list_end(&l);
+			for (k = list_size(&l) - 1; k > pos; --k){
+				it = list_iterator_rewind(it);
+			}
+		}
+
+		if (i & 1){
+			list_delete(&l, it);
+		} else {
+			list_insert(&l, it, item);
+		}
+
+		++i;
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l);
+}
+
+static void list_growth(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	list_t l;
+
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		list_init(&l, el_size);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				list_push_back(&l, item);
+			}
+			bench_batch_end(t);
+		}
+		list_destroy(&l);
+	}
+}
+
+#define REBALANCE_BATCH 64 /* Elements moved at once by list/rebalance */
+
+/*
+ * Batch rebalancing between two lists: runs of up to REBALANCE_BATCH
+ * elements go from the front of one to the back of the other until it's
+ * empty, and then back. list/rebalance relinks each run with list_splice,
+ * walking to its last element; list/rebalance_copy pops and pushes every
+ * element. An op is one element moved.
+ */
+static void list_rebalance_run(bench_timer_t *t, size_t el_size,
+		unsigned long n, uint8_t splice)
+{
+	unsigned long i, k, end, moves = ops_budget;
+	list_iterator_t last;
+	list_t l[2];
+	uint8_t from = 0;
+
+	list_init(&l[0], el_size);
+	list_init(&l[1], el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		list_push_back(&l[0], item);
+	}
+
+	for (i = 0; i < moves; ){
+		if (list_empty(&l[from])){
+			from = !from;
+		}
+		k = list_size(&l[from]) < REBALANCE_BATCH ?
+				list_size(&l[from]) : REBALANCE_BATCH;
+		end = bench_batch_begin(t, i, i + k);
+		if (splice){
+			last = list_begin(&l[from]);
+			for (k = end - i; k > 1; --k){
+				last = list_iterator_advance(last);
+			}
+			list_splice(&l[!from], NULL, &l[from], list_begin(&l[from]),
+					last);
+			i = end;
+		} else {
+			for (; i < end; ++i){
+				list_pop_front(&l[from], out);
+				list_push_back(&l[!from], out);
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l[0]);
+	list_destroy(&l[1]);
+}
+
+static void list_rebalance(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	list_rebalance_run(t, el_size, n, 1);
+}
+
+static void list_rebalance_copy(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	list_rebalance_run(t, el_size, n, 0);
+}
+
+/*
+ * list_sort over n random keys, which are drawn again in place between
+ * rounds. An op is one element sorted.
+ */
+static void list_sort_keys(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, r, rounds = rounds_for(n);
+	list_iterator_t it;
+	list_t l;
+
+	list_init(&l, el_size);
+	key_el_size = el_size;
+	set_key(item, el_size, 0);
+
+	for (i = 0; i < n; ++i){
+		list_push_back(&l, item);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		it = list_begin(&l);
+		for (i = 0; i < n; ++i){
+			set_key(list_iterator_data(it), el_size, bench_rand(&rng));
+			it = list_iterator_advance(it);
+		}
+
+		bench_batch_begin(t, 0, n);
+		list_sort(&l, key_order);
+		t->batch_ops = n;
+		bench_batch_end(t);
+	}
+
+	list_destroy(&l);
+}
+
+/* ************************************************** */
+
+static void ulist_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	ulist_t l;
+
+	ulist_init(&l, el_size);
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				ulist_push_back(&l, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				ulist_pop_front(&l, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	ulist_destroy(&l);
+}
+
+static void ulist_traverse(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	ulist_iterator_t it;
+	unsigned long sum = 0;
+	ulist_t l;
+
+	ulist_init(&l, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		ulist_push_back(&l, item);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		it = ulist_begin(&l);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				sum += *(unsigned char *) ulist_iterator_data(&l, it);
+				ulist_iterator_advance(&it);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	if (sum != rounds * key_sum(el_size, n)){
+		abort();
+	}
+
+	ulist_destroy(&l);
+}
+
+static void ulist_search_scan(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, end, searches = rounds_for(n / 2 + 1);
+	ulist_t l;
+
+	ulist_init(&l, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		ulist_push_back(&l, item);
+	}
+
+	for (i = 0; i < searches; ){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		end = bench_batch_begin(t, i, i + 1);
+		for (; i < end; ++i){
+			if (ulist_search(&l, item).node == NULL){
+				abort();
+			}
+		}
+		bench_batch_end(t);
+	}
+
+	ulist_destroy(&l);
+}
+
+/*
+ * Same as list/random_ins_del. Nodes split and merge along the run.
+ */
+static void ulist_random_ins_del(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, k, pos, steps = rounds_for(n / 4 + 1) * 4;
+	ulist_iterator_t it;
+	ulist_t l;
+
+	ulist_init(&l, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		ulist_push_back(&l, item);
+	}
+
+	for (i = 0; i < steps; ){
+		pos = bench_rand(&rng) % ulist_size(&l);
+		bench_batch_begin(t, i, i + 1);
+
+		if (pos < ulist_size(&l) / 2){
+			it = ulist_begin(&l);
+			for (k = 0; k < pos; ++k){
+				ulist_iterator_advance(&it);
+			}
+		} else {
+			it = ulist_end(&l);
+			for (k = ulist_size(&l) - 1; k > pos; --k){
+				ulist_iterator_rewind(&it);
+			}
+		}
+
+		if (i & 1){
+			ulist_delete(&l, it);
+		} else {
+			ulist_insert(&l, it, item);
+		}
+
+		++i;
+		bench_batch_end(t);
+	}
+
+	ulist_destroy(&l);
+}
+
+static void ulist_growth(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	ulist_t l;
+
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		ulist_init(&l, el_size);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				ulist_push_back(&l, item);
+			}
+			bench_batch_end(t);
+		}
+		ulist_destroy(&l);
+	}
+}
+
+/* ************************************************** */
+
+/*
+ * Objects of an ilist_t workload: the link followed by el_size bytes of
+ * payload, all in one caller owned array, as a user of the intrusive list
+ * would have them.
+ */
+typedef struct bench_obj{
+	list_link_t link;
+	unsigned char data[];
+} bench_obj_t;
+
+static bench_obj_t *obj_at(unsigned char *arena, size_t stride,
+		unsigned long i)
+{
+	return (bench_obj_t *) (arena + stride * i);
+}
+
+static size_t obj_stride(size_t el_size)
+{
+	size_t a = sizeof(list_link_t);
+
+	return (sizeof(bench_obj_t) + el_size + a - 1) / a * a;
+}
+
+/* Same cycle as list/push_pop, linking objects instead of copying items */
+static void ilist_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	size_t stride = obj_stride(el_size);
+	unsigned char *arena = malloc(stride * n);
+	list_link_t *lk;
+	ilist_t l;
+
+	ilist_init(&l);
+	for (i = 0; i < n; ++i){
+		set_key(obj_at(arena, stride, i)->data, el_size, 1);
+	}
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				ilist_push_back(&l, &obj_at(arena, stride, i)->link);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				lk = ilist_pop_front(&l);
+				memcpy(out, list_container_of(lk, bench_obj_t, link)->data,
+						el_size);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	free(arena);
+}
+
+/*
+ * LRU touch: a random object of the n linked is moved to the front, what
+ * a cache does on every hit. With list_t the same takes a search.
+ */
+static void ilist_lru(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, touches = ops_budget;
+	size_t stride = obj_stride(el_size);
+	unsigned char *arena = malloc(stride * n);
+	ilist_t l;
+
+	ilist_init(&l);
+	for (i = 0; i < n; ++i){
+		set_key(obj_at(arena, stride, i)->data, el_size, i);
+		ilist_push_back(&l, &obj_at(arena, stride, i)->link);
+	}
+
+	for (i = 0; i < touches; ){
+		end = bench_batch_begin(t, i, touches);
+		for (; i < end; ++i){
+			ilist_move_front(&l,
+					&obj_at(arena, stride, bench_rand(&rng) % n)->link);
+		}
+		bench_batch_end(t);
+	}
+
+	free(arena);
+}
+
+/* ************************************************** */
+
+/*
+ * A list kept sorted by walking from the front to the first bigger key
+ * and inserting there, what pq/push_pop is measured against. Pushes n
+ * random keys and pops them all.
+ */
+static void list_sorted_insert(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, k, end, r, rounds = rounds_for(2 * n);
+	list_iterator_t it;
+	list_t l;
+
+	list_init(&l, el_size);
+	key_el_size = el_size;
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				set_key(item, el_size, bench_rand(&rng));
+				/* Past the last element it lands on the sentinel */
+				it = list_begin(&l);
+				for (k = 0; k < list_size(&l) &&
+						key_order(list_iterator_data(it), item) <= 0; ++k){
+					it = list_iterator_advance(it);
+				}
+				list_insert(&l, it, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				list_pop_front(&l, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	list_destroy(&l);
+}
+
+/* ************************************************** */
+
+/*
+ * Pushes n random keys and pops them all, in order.
+ */
+static void pq_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(2 * n);
+	pq_t q;
+
+	key_el_size = el_size;
+	pq_init(&q, el_size, key_order);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				set_key(item, el_size, bench_rand(&rng));
+				pq_push(&q, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				pq_pop(&q, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	pq_destroy(&q);
+}
+
+/*
+ * Timer wheel pattern: n pending keys, each op pops the first one and
+ * pushes it back later by a random amount, so the size stays n.
+ */
+static void pq_hold(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, ops = ops_budget / 2;
+	uint32_t key;
+	pq_t q;
+
+	key_el_size = el_size;
+	pq_init(&q, el_size, key_order);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, bench_rand(&rng) % n);
+		pq_push(&q, item);
+	}
+
+	for (i = 0; i < ops; ){
+		end = bench_batch_begin(t, i, ops);
+		for (; i < end; ++i){
+			pq_pop(&q, out);
+			key = 0;
+			memcpy(&key, out, el_size < sizeof(key) ? el_size : sizeof(key));
+			set_key(item, el_size, key + bench_rand(&rng) % n);
+			pq_push(&q, item);
+		}
+		bench_batch_end(t);
+	}
+
+	pq_destroy(&q);
+}
+
+/*
+ * Builds the heap from an array of n random keys in one go. An op is one
+ * element placed.
+ */
+static void pq_heapify_bulk(bench_timer_t *t, size_t el_size,
+		unsigned long n)
+{
+	unsigned long i, r, rounds = rounds_for(n);
+	unsigned char *items = malloc(el_size * n);
+	pq_t q;
+
+	key_el_size = el_size;
+	pq_init(&q, el_size, key_order);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ++i){
+			set_key(items + el_size * i, el_size, bench_rand(&rng));
+		}
+		bench_batch_begin(t, 0, n);
+		pq_heapify(&q, items, n);
+		t->batch_ops = n;
+		bench_batch_end(t);
+	}
+
+	free(items);
+	pq_destroy(&q);
+}
+
+/* ************************************************** */
+
+/*
+ * Pushes at the back and pops at the front, like queue/push_pop, then
+ * the other way around, so both ends grow and release blocks.
+ */
+static void deque_push_pop(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(4 * n);
+	deque_t d;
+
+	deque_init(&d, el_size);
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				deque_push_back(&d, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				deque_pop_front(&d, out);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				deque_push_front(&d, item);
+			}
+			bench_batch_end(t);
+		}
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				deque_pop_back(&d, out);
+			}
+			bench_batch_end(t);
+		}
+	}
+
+	deque_destroy(&d);
+}
+
+static void deque_fifo(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, pairs = ops_budget / 2;
+	deque_t d;
+
+	deque_init(&d, el_size);
+	set_key(item, el_size, 1);
+
+	for (i = 0; i < n; ++i){
+		deque_push_back(&d, item);
+	}
+
+	for (i = 0; i < pairs; ){
+		end = bench_batch_begin(t, i, pairs);
+		for (; i < end; ++i){
+			deque_push_back(&d, item);
+			deque_pop_front(&d, out);
+		}
+		bench_batch_end(t);
+	}
+
+	deque_destroy(&d);
+}
+
+/*
+ * Reads elements at uniform random positions. An op is one deque_at.
+ */
+static void deque_index(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, reads = ops_budget;
+	unsigned long sum = 0;
+	deque_t d;
+
+	deque_init(&d, el_size);
+
+	for (i = 0; i < n; ++i){
+		set_key(item, el_size, i);
+		deque_push_front(&d, item);
+	}
+
+	for (i = 0; i < reads; ){
+		end = bench_batch_begin(t, i, reads);
+		for (; i < end; ++i){
+			sum += *(unsigned char *) deque_at(&d, bench_rand(&rng) % n);
+		}
+		bench_batch_end(t);
+	}
+
+	out[0] = sum; /* So the reads are not optimized out */
+	deque_destroy(&d);
+}
+
+static void deque_growth(bench_timer_t *t, size_t el_size, unsigned long n)
+{
+	unsigned long i, end, r, rounds = rounds_for(n);
+	deque_t d;
+
+	set_key(item, el_size, 1);
+
+	for (r = 0; r < rounds; ++r){
+		deque_init(&d, el_size);
+		for (i = 0; i < n; ){
+			end = bench_batch_begin(t, i, n);
+			for (; i < end; ++i){
+				deque_push_back(&d, item);
+			}
+			bench_batch_end(t);
+		}
+		deque_destroy(&d);
+	}
+}
+
+/* ************************************************** */
+
+static const workload_t workloads[] = {
+	{"stack", "push_pop", stack_push_pop, 0},
+	{"stack", "growth", stack_growth, 0},
+	{"stack", "find", stack_find_scan, 0},
+	{"stack", "find_scalar", stack_find_scalar, 0},
+	{"queue", "push_pop", queue_push_pop, 0},
+	{"queue", "fifo", queue_fifo, 0},
+	{"queue", "growth", queue_growth, 0},
+	{"queue", "find", queue_find_scan, 0},
+	{"list", "push_pop", list_push_pop, 0},
+	{"list", "fifo", list_fifo, 0},
+	{"list", "search", list_search_scan, 0},
+	{"list", "lookup", list_lookup_index, 0},
+	{"list", "random_ins_del", list_random_ins_del, 100000},
+	{"list", "growth", list_growth, 0},
+	{"list", "traverse", list_traverse, 0},
+	{"list", "sorted_insert", list_sorted_insert, 10000},
+	{"list", "rebalance", list_rebalance, 0},
+	{"list", "rebalance_copy", list_rebalance_copy, 0},
+	{"list", "sort", list_sort_keys, 0},
+	{"pq", "push_pop", pq_push_pop, 0},
+	{"pq", "hold", pq_hold, 0},
+	{"pq", "heapify", pq_heapify_bulk, 0},
+	{"deque", "push_pop", deque_push_pop, 0},
+	{"deque", "fifo", deque_fifo, 0},
+	{"deque", "index", deque_index, 0},
+	{"deque", "growth", deque_growth, 0},
+	{"ulist", "push_pop", ulist_push_pop, 0},
+	{"ulist", "traverse", ulist_traverse, 0},
+	{"ulist", "search", ulist_search_scan, 0},
+	{"ulist", "random_ins_del", ulist_random_ins_del, 100000},
+	{"ulist", "growth", ulist_growth, 0},
+	{"ilist", "push_pop", ilist_push_pop, 0},
+	{"ilist", "lru", ilist_lru, 0},
+};
+
+/* ************************************************** */
+
+/*
+ * @brief One run of a workload.
+ * @var w Workload to run.
+ * @var el_size Element size.
+ * @var n Container size.
+ * @var seed Random seed of the suite.
+ */
+typedef struct bench_case{
+	const workload_t *w;
+	size_t el_size;
+	unsigned long n;
+	uint64_t seed;
+} bench_case_t;
+
+static void run_case(void *ctx)
+{
+	const bench_case_t *c = ctx;
+	bench_result_t r;
+	bench_timer_t t;
+
+	rng = c->seed ^ (c->n * 2654435761UL) ^ c->el_size;
+	if (rng == 0){
+		rng = DEFAULT_SEED;
+	}
+
+	bench_timer_init(&t, 0);
+	c->w->run(&t, c->el_size, c->n);
+
+	r.container = c->w->container;
+	r.workload = c->w->name;
+	r.el_size = c->el_size;
+	r.n = c->n;
+	r.threads = 1;
+	bench_timer_finish(&t, &r);
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long min_n = DEFAULT_MIN_N, max_n = DEFAULT_MAX_N, n;
+	uint64_t seed = DEFAULT_SEED;
+	const char *filter = NULL;
+	bench_case_t c;
+	char name[64];
+	unsigned int w, e;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:m:o:s:w:")) != -1){
+		switch (opt){
+		case 'n': max_n = strtoul(optarg, NULL, 0); break;
+		case 'm': min_n = strtoul(optarg, NULL, 0); break;
+		case 'o': ops_budget = strtoul(optarg, NULL, 0); break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'w': filter = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-n max_n] [-m min_n] [-o ops] "
+					"[-s seed] [-w filter]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (n = min_n; n && n <= max_n; n *= 10){
+		for (e = 0; e < sizeof(el_sizes) / sizeof(el_sizes[0]); ++e){
+			for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w){
+				snprintf(name, sizeof(name), "%s/%s", workloads[w].container,
+						workloads[w].name);
+				if (filter != NULL && strstr(name, filter) == NULL){
+					continue;
+				}
+				if (workloads[w].max_n && n > workloads[w].max_n){
+					continue;
+				}
+				c.w = &workloads[w];
+				c.el_size = el_sizes[e];
+				c.n = n;
+				c.seed = seed;
+				bench_run_forked(run_case, &c);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "stack_typed.h"
+#include "queue_typed.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#define DEFAULT_ITEMS 1000000UL
+#define ROUNDS 20
+
+/*
+ * Fills and drains a stack and a queue of int32_t, once through the
+ * generic void * API and once through the DECLARE_* front-ends, and
+ * checks both give back the same sum.
+ */
+
+DECLARE_STACK(int32, int32_t)
+DECLARE_QUEUE(int32, int32_t)
+
+static unsigned long n_items = DEFAULT_ITEMS;
+
+static void report(const char *container, const char *name, double t,
+		int64_t sum)
+{
+	bench_result_t r = {container, name, sizeof(int32_t), n_items, 1};
+
+	/* Every path must see the same items */
+	if (sum != (int64_t) n_items * (n_items - 1) / 2 * ROUNDS){
+		fprintf(stderr, "%s: wrong sum %lld\n", name, (long long) sum);
+		exit(1);
+	}
+
+	r.ops = 2 * n_items * ROUNDS; /* A push and a pop each */
+	r.ns = t;
+	r.p50_batch = r.p99_batch = r.cpu_ns = -1;
+	r.rss_kb = bench_peak_rss();
+	bench_print(&r);
+}
+
+/* ************************************************** */
+
+static int64_t stack_generic(stack_t *s)
+{
+	int32_t i, v;
+	int64_t sum = 0;
+
+	for (i = 0; i < (int32_t) n_items; ++i){
+		stack_push(s, &i);
+	}
+	while (!stack_empty(s)){
+		stack_pop(s, &v);
+		sum += v;
+	}
+
+	return sum;
+}
+
+static int64_t stack_typed(stack_t *s)
+{
+	int32_t i, v;
+	int64_t sum = 0;
+
+	for (i = 0; i < (int32_t) n_items; ++i){
+		stack_int32_push(s, i);
+	}
+	while (!stack_empty(s)){
+		stack_int32_pop(s, &v);
+		sum += v;
+	}
+
+	return sum;
+}
+
+static int64_t queue_generic(queue_t *q)
+{
+	int32_t i, v;
+	int64_t sum = 0;
+
+	for (i = 0; i < (int32_t) n_items; ++i){
+		queue_push_back(q, &i);
+	}
+	while (!queue_empty(q)){
+		queue_pop_front(q, &v);
+		sum += v;
+	}
+
+	return sum;
+}
+
+static int64_t queue_typed(queue_t *q)
+{
+	int32_t i, v;
+	int64_t sum = 0;
+
+	for (i = 0; i < (int32_t) n_items; ++i){
+		queue_int32_push_back(q, i);
+	}
+	while (!queue_empty(q)){
+		queue_int32_pop_front(q, &v);
+		sum += v;
+	}
+
+	return sum;
+}
+
+/* ************************************************** */
+
+int main(int argc, char *argv[])
+{
+	stack_t s;
+	queue_t q;
+	int64_t sum;
+	unsigned int r;
+	double t;
+
+	if (argc > 1){
+		n_items = strtoul(argv[1], NULL, 0);
+	}
+
+	/* Buffers are grown before timing, both paths reuse them */
+	stack_int32_init(&s);
+	queue_int32_init(&q);
+	stack_generic(&s);
+	queue_generic(&q);
+
+	for (sum = 0, r = 0, t = bench_now(); r < ROUNDS; ++r){
+		sum += stack_generic(&s);
+	}
+	report("stack", "generic", bench_now() - t, sum);
+
+	for (sum = 0, r = 0, t = bench_now(); r < ROUNDS; ++r){
+		sum += stack_typed(&s);
+	}
+	report("stack", "typed", bench_now() - t, sum);
+
+	for (sum = 0, r = 0, t = bench_now(); r < ROUNDS; ++r){
+		sum += queue_generic(&q);
+	}
+	report("queue", "generic", bench_now() - t, sum);
+
+	for (sum = 0, r = 0, t = bench_now(); r < ROUNDS; ++r){
+		sum += queue_typed(&q);
+	}
+	report("queue", "typed", bench_now() - t, sum);
+
+	stack_destroy(&s);
+	queue_destroy(&q);
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include "find.h"
+#include <string.h> /* For memcmp, memcpy */
+#include <stdint.h> /* For int types */
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define FIND_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * @brief Kernel searching n elements of a fixed size.
+ */
+typedef size_t (*find_kernel_t)(const unsigned char *p, size_t n,
+		size_t el_size, const void *key);
+
+/* ************************************************** */
+/**
+ * @brief Keeps, out of a byte compare mask, only the bits of the first
+ * byte of elements whose bytes all matched.
+ * @param m Byte mask, bit i set if byte i matched.
+ * @param el_size Size of the elements, 1, 2, 4 or 8.
+ * @return Mask with one bit per matching element.
+ */
+static inline uint32_t find_lanes(uint32_t m, size_t el_size){
+
+	if (el_size >= 2){
+		m &= (m >> 1) & 0x55555555;
+	}
+	if (el_size >= 4){
+		m &= (m >> 2) & 0x11111111;
+	}
+	if (el_size >= 8){
+		m &= (m >> 4) & 0x01010101;
+	}
+
+	return m;
+}
+
+/* ************************************************** */
+
+size_t elm_find_scalar(const void *base, size_t n, size_t el_size,
+		const void *key){
+
+	const unsigned char *p = base;
+	size_t i;
+
+	for (i = 0; i < n; ++i, p += el_size){
+		if (memcmp(p, key, el_size) == 0){
+			return i;
+		}
+	}
+
+	return n;
+}
+
+/* ************************************************** */
+/**
+ * @brief elm_find_scalar with the kernel signature, for when there's no
+ * vector kernel. Calling it through a cast pointer would be undefined.
+ */
+static size_t find_scalar(const unsigned char *p, size_t n, size_t el_size,
+		const void *key){
+
+	return elm_find_scalar(p, n, el_size, key);
+}
+
+#ifdef FIND_X86
+
+/* ************************************************** */
+/**
+ * @brief Compares 16 bytes, 16 / el_size elements, per step. The key is
+ * repeated along the register so one byte compare covers every size.
+ */
+static size_t find_sse2(const unsigned char *p, size_t n, size_t el_size,
+		const void *key){
+
+	unsigned char pat[16];
+	size_t per = 16 / el_size;
+	size_t i, j;
+	uint32_t m;
+	__m128i k;
+
+	for (j = 0; j < 16; j += el_size){
+		memcpy(pat + j, key, el_size);
+	}
+	k = _mm_loadu_si128((const __m128i *) pat);
+
+	for (i = 0; i + per <= n; i += per){
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(k,
+				_mm_loadu_si128((const __m128i *) (p + i * el_size))));
+		m = find_lanes(m, el_size);
+		if (m){
+			return i + __builtin_ctz(m) / el_size;
+		}
+	}
+
+	return i + elm_find_scalar(p + i * el_size, n - i, el_size, key);
+}
+
+/* ************************************************** */
+/**
+ * @brief Same as find_sse2 with 32 byte registers.
+ */
+__attribute__((target("avx2")))
+static size_t find_avx2(const unsigned char *p, size_t n, size_t el_size,
+		const void *key){
+
+	unsigned char pat[32];
+	size_t per = 32 / el_size;
+	size_t i, j;
+	uint32_t m;
+	__m256i k;
+
+	for (j = 0; j < 32; j += el_size){
+		memcpy(pat + j, key, el_size);
+	}
+	k = _mm256_loadu_si256((const __m256i *) pat);
+
+	for (i = 0; i + per <= n; i += per){
+		m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(k,
+				_mm256_loadu_si256((const __m256i *) (p + i * el_size))));
+		m = find_lanes(m, el_size);
+		if (m){
+			return i + __builtin_ctz(m) / el_size;
+		}
+	}
+
+	return i + find_sse2(p + i * el_size, n - i, el_size, key);
+}
+
+#endif /* FIND_X86 */
+
+/* Vector kernel for the sizes it handles, picked at start up */
+static find_kernel_t find_vector = find_scalar;
+
+/* ************************************************** */
+/**
+ * @brief Runs before main and picks the kernel once, so searches don't
+ * check the CPU again.
+ */
+__attribute__((constructor))
+static void find_dispatch(void){
+
+#ifdef FIND_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")){
+		find_vector = find_avx2;
+	} else {
+		find_vector = find_sse2;
+	}
+#endif
+}
+
+/* ************************************************** */
+
+size_t elm_find(const void *base, size_t n, size_t el_size,
+		const void *key){
+
+	switch (el_size){
+	case 1: case 2: case 4: case 8:
+		return find_vector(base, n, el_size, key);
+	default:
+		return elm_find_scalar(base, n, el_size, key);
+	}
+}
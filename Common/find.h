@@ -0,0 +1,33 @@
+/**
+ * @file find.h
+ * @author Juan Manuel Torres Palma
+ * @brief Linear search over contiguous arrays declaration file
+ */
+
+#ifndef FIND_H_
+#define FIND_H_
+
+#include <stdlib.h> // For size_t
+
+/*
+ * @brief Finds the first element of an array equal, byte by byte, to a
+ * key. For 1, 2, 4 and 8 byte elements compares a whole vector register
+ * of them at a time, with the best kernel the CPU supports picked at
+ * start up (AVX2, SSE2). Other sizes use memcmp.
+ * @param [in] base Pointer to the first element.
+ * @param [in] n Number of elements.
+ * @param [in] el_size Size in bytes of a single element.
+ * @param [in] key Pointer to the searched element.
+ * @return Index of the first match, n if there's none.
+ */
+size_t elm_find(const void *base, size_t n, size_t el_size,
+		const void *key);
+
+/*
+ * @brief Same as elm_find with plain memcmp, one element at a time.
+ * The reference the vector kernels are checked and measured against.
+ */
+size_t elm_find_scalar(const void *base, size_t n, size_t el_size,
+		const void *key);
+
+#endif /* FIND_H_ */
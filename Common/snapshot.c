@@ -0,0 +1,98 @@
+#include "snapshot.h"
+#include <errno.h> //For EINTR
+#include <unistd.h> //For readv and writev
+
+/* ************************************************** */
+/**
+ * @brief Moves past the first done bytes of a segment array, dropping the
+ * segments completed.
+ * @param iov Pointer to the first segment, updated.
+ * @param cnt Number of segments, updated.
+ * @param done Bytes transferred.
+ */
+static void snap_advance(struct iovec **iov, int *cnt, size_t done){
+
+	while (*cnt > 0 && done >= (*iov)->iov_len){
+		done -= (*iov)->iov_len;
+		++*iov;
+		--*cnt;
+	}
+
+	if (*cnt > 0){
+		(*iov)->iov_base = (unsigned char *) (*iov)->iov_base + done;
+		(*iov)->iov_len -= done;
+	}
+}
+
+/* ************************************************** */
+
+unsigned char snap_write_header(int fd, size_t el_size, size_t count){
+
+	snap_header_t hdr = {SNAP_MAGIC, SNAP_VERSION, el_size, count};
+	struct iovec iov = {&hdr, sizeof(hdr)};
+
+	return snap_writev(fd, &iov, 1);
+}
+
+/* ************************************************** */
+
+unsigned char snap_read_header(int fd, snap_header_t *hdr){
+
+	struct iovec iov = {hdr, sizeof(*hdr)};
+
+	if (snap_readv(fd, &iov, 1)){
+		return 1;
+	}
+
+	/* The payload size has to fit a size_t, or it would wrap */
+	return (hdr->magic != SNAP_MAGIC || hdr->version != SNAP_VERSION ||
+			hdr->el_size == 0 || hdr->el_size > SIZE_MAX ||
+			hdr->count > SIZE_MAX / hdr->el_size);
+}
+
+/* ************************************************** */
+
+unsigned char snap_writev(int fd, struct iovec *iov, int cnt){
+
+	ssize_t done;
+
+	snap_advance(&iov, &cnt, 0); //Skip empty segments
+
+	while (cnt > 0){
+		done = writev(fd, iov, cnt);
+		if (done < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			return 1;
+		}
+		snap_advance(&iov, &cnt, done);
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char snap_readv(int fd, struct iovec *iov, int cnt){
+
+	ssize_t done;
+
+	snap_advance(&iov, &cnt, 0);
+
+	while (cnt > 0){
+		done = readv(fd, iov, cnt);
+		if (done < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			return 1;
+		}
+		if (done == 0){
+			return 1; //Truncated snapshot
+		}
+		snap_advance(&iov, &cnt, done);
+	}
+
+	return 0;
+}
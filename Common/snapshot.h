@@ -0,0 +1,87 @@
+/**
+ * @file snapshot.h
+ * @author Juan Manuel Torres Palma
+ * @brief Container snapshot format declaration file
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For int types
+#include <sys/uio.h> // For struct iovec
+
+#define SNAP_MAGIC 0x53534447 // "GDSS" read as little endian
+#define SNAP_VERSION 1
+
+/*
+ * @brief Bytes gathered per write by containers whose elements are not
+ * contiguous. One system call per segment costs more than copying a small
+ * element, so they're packed in a buffer of this size first.
+ */
+#define SNAP_CHUNK 16384
+
+/*
+ * @brief Start of a snapshot, followed by count packed elements in
+ * container order: bottom to top for stacks, front to back for queues and
+ * lists. Fields are in host byte order, so snapshots are meant to be read
+ * back on the same kind of machine.
+ * @var magic SNAP_MAGIC, tells a snapshot.
+ * @var version Format version, SNAP_VERSION.
+ * @var el_size Size of each element.
+ * @var count Number of elements.
+ */
+typedef struct snap_header{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t el_size;
+	uint64_t count;
+} snap_header_t;
+
+/*
+ * @brief Writes a snapshot header.
+ * @param [in] fd File descriptor to write to.
+ * @param [in] el_size Size of each element.
+ * @param [in] count Number of elements that will follow.
+ * @return Status of the operation.
+ * @retval 0 Header written.
+ * @retval 1 Write error.
+ */
+unsigned char snap_write_header(int fd, size_t el_size, size_t count);
+
+/*
+ * @brief Reads and checks a snapshot header.
+ * @param [in] fd File descriptor to read from.
+ * @param [out] hdr Where to store the header.
+ * @return Status of the operation.
+ * @retval 0 Valid header read.
+ * @retval 1 Read error, not a snapshot of this version, or a payload,
+ * el_size times count, too big for a size_t.
+ */
+unsigned char snap_read_header(int fd, snap_header_t *hdr);
+
+/*
+ * @brief Writes all the segments, going on after partial writes and
+ * interrupted calls. The array is modified.
+ * @param [in] fd File descriptor to write to.
+ * @param [in] iov Segments to write.
+ * @param [in] cnt Number of segments.
+ * @return Status of the operation.
+ * @retval 0 All written.
+ * @retval 1 Write error.
+ */
+unsigned char snap_writev(int fd, struct iovec *iov, int cnt);
+
+/*
+ * @brief Fills all the segments, going on after partial reads and
+ * interrupted calls. The array is modified.
+ * @param [in] fd File descriptor to read from.
+ * @param [in] iov Segments to fill.
+ * @param [in] cnt Number of segments.
+ * @return Status of the operation.
+ * @retval 0 All filled.
+ * @retval 1 Read error or end of file first.
+ */
+unsigned char snap_readv(int fd, struct iovec *iov, int cnt);
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,44 @@
+#include "stats.h"
+#include <string.h> //For memset
+
+#ifdef DS_STATS
+
+void ds_stats_init(ds_stats_t *const st, size_t capacity){
+
+	memset(st, 0, sizeof(ds_stats_t));
+	st->capacity = capacity;
+}
+
+/* ************************************************** */
+/**
+ * The hook sees the counters already updated, so it can read them from
+ * the container.
+ */
+void ds_stats_resize(ds_stats_t *const st, const void *container,
+		size_t capacity, size_t bytes){
+
+	size_t old_cap = st->capacity;
+
+	++st->resizes;
+	st->resize_bytes += bytes;
+	st->capacity = capacity;
+
+	if (st->on_resize != NULL){
+		st->on_resize(container, old_cap, capacity);
+	}
+}
+
+/* ************************************************** */
+
+void ds_stats_dump(const ds_stats_t *const st, const char *name,
+		size_t size, FILE *f){
+
+	fprintf(f, "{\"container\":\"%s\",\"size\":%zu,\"capacity\":%zu,"
+			"\"high_water\":%zu,\"pushes\":%llu,\"pops\":%llu,"
+			"\"resizes\":%llu,\"resize_bytes\":%llu,"
+			"\"comparisons\":%llu}\n", name, size, st->capacity,
+			st->high_water, st->pushes, st->pops, st->resizes,
+			st->resize_bytes, st->comparisons);
+}
+
+#endif /* DS_STATS */
@@ -0,0 +1,118 @@
+/**
+ * @file stats.h
+ * @author Juan Manuel Torres Palma
+ * @brief Optional container instrumentation declaration file
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdlib.h> // For size_t
+#include <stdio.h> // For FILE
+
+/*
+ * @brief Called every time a container changes its capacity.
+ * @param container Pointer to the container resized.
+ * @param old_cap Capacity before, in elements.
+ * @param new_cap Capacity after, in elements.
+ */
+typedef void (*ds_resize_hook_t)(const void *container, size_t old_cap,
+		size_t new_cap);
+
+/*
+ * @brief Counters of a container instance. Only containers built with
+ * DS_STATS defined carry them, as a field named stats; otherwise the
+ * field and every update compile to nothing.
+ * @var pushes Elements added.
+ * @var pops Elements removed.
+ * @var resizes Capacity changes.
+ * @var resize_bytes Bytes of elements, or block pointers, copied to
+ * resize or rebalance.
+ * @var comparisons Elements compared by searches.
+ * @var capacity Current capacity, in elements.
+ * @var high_water Most elements held at once.
+ * @var on_resize Hook called on resize, NULL for none.
+ */
+typedef struct ds_stats{
+	unsigned long long pushes;
+	unsigned long long pops;
+	unsigned long long resizes;
+	unsigned long long resize_bytes;
+	unsigned long long comparisons;
+	size_t capacity;
+	size_t high_water;
+	ds_resize_hook_t on_resize;
+} ds_stats_t;
+
+#ifdef DS_STATS
+
+#define DS_STATS_FIELD ds_stats_t stats;
+
+/*
+ * @brief Updates. c is a pointer to the container, which must have been
+ * built with the stats field.
+ */
+#define ds_stat_init(c, cap)			ds_stats_init(&(c)->stats, (cap))
+#define ds_stat_push(c, n, size)		ds_stats_push(&(c)->stats, (n), (size))
+#define ds_stat_pop(c, n)				((c)->stats.pops += (n))
+#define ds_stat_cmp(c, n)				((c)->stats.comparisons += (n))
+#define ds_stat_copy(c, bytes)			((c)->stats.resize_bytes += (bytes))
+#define ds_stat_resize(c, cap, bytes)	\
+	ds_stats_resize(&(c)->stats, (c), (cap), (bytes))
+
+/*
+ * @brief Clears the counters and the hook.
+ * @param [in] st Pointer to the counters.
+ * @param [in] capacity Capacity the container starts with.
+ */
+void ds_stats_init(ds_stats_t *const st, size_t capacity);
+
+/*
+ * @brief Records a capacity change and calls the hook, if any.
+ * @param [in] st Pointer to the counters.
+ * @param [in] container Pointer to the container, passed to the hook.
+ * @param [in] capacity New capacity.
+ * @param [in] bytes Bytes copied to resize.
+ */
+void ds_stats_resize(ds_stats_t *const st, const void *container,
+		size_t capacity, size_t bytes);
+
+/*
+ * @brief Writes the counters as one JSON object per line, the format of
+ * the benchmark output.
+ * @param [in] st Pointer to the counters.
+ * @param [in] name Container name.
+ * @param [in] size Current number of elements.
+ * @param [in] f Stream to write to.
+ */
+void ds_stats_dump(const ds_stats_t *const st, const char *name,
+		size_t size, FILE *f);
+
+/*
+ * @brief Counts added elements and raises the high-water mark.
+ * @param [in] st Pointer to the counters.
+ * @param [in] n Number of elements added.
+ * @param [in] size Number of elements after adding them.
+ */
+static inline void ds_stats_push(ds_stats_t *const st, size_t n, size_t size)
+{
+	st->pushes += n;
+	if (size > st->high_water){
+		st->high_water = size;
+	}
+}
+
+#else
+
+#define DS_STATS_FIELD
+
+#define ds_stat_init(c, cap)			((void) 0)
+#define ds_stat_push(c, n, size)		((void) 0)
+#define ds_stat_pop(c, n)				((void) 0)
+#define ds_stat_cmp(c, n)				((void) 0)
+#define ds_stat_copy(c, bytes)			((void) 0)
+#define ds_stat_resize(c, cap, bytes)	((void) (bytes))
+
+#endif /* DS_STATS */
+
+#endif /* STATS_H_ */
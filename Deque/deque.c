@@ -0,0 +1,340 @@
+#include "deque.h"
+#include <stdlib.h> //For malloc, calloc and free
+#include <string.h>  //For memcpy and memmove
+
+#define DEQUE_BLOCK_BYTES 4096 //Target block size
+#define DEQUE_MIN_BLOCK_ELM 16 //Fewest elements per block
+#define DEFAULT_DEQUE_MAP 8 //Initial map slots
+
+/**
+ * @brief Macro to get the address of the element at an offset.
+ * @param deque Pointer to the deque structure.
+ * @param off Offset of the element, its block must be in use.
+ */
+#define deque_calc_address(deque, off)								\
+	((unsigned char *) (deque)->map[(off) >> (deque)->shift] +		\
+	 (deque)->el_size * ((off) & (((size_t) 1 << (deque)->shift) - 1)))
+
+/**
+ * @brief Macro to get the map slot of the block holding an offset.
+ */
+#define deque_block(deque, off) ((deque)->map[(off) >> (deque)->shift])
+
+/* ************************************************** */
+/**
+ * @brief Offset of the first element of the middle block, where an empty
+ * deque starts so it can grow both ways before touching the map.
+ */
+static inline size_t deque_middle(deque_t *const my_d){
+
+	return (size_t) (my_d->map_size / 2) << my_d->shift;
+}
+
+/* ************************************************** */
+/**
+ * @brief Puts a block in a map slot, the spare one if there is.
+ * @param my_d Pointer to the deque.
+ * @param slot Map slot to fill.
+ * @return 0 if done, 1 if malloc failed.
+ */
+static unsigned char deque_block_get(deque_t *const my_d, void **slot){
+
+	if (my_d->spare != NULL){
+		*slot = my_d->spare;
+		my_d->spare = NULL;
+		return 0;
+	}
+
+	*slot = malloc(my_d->el_size << my_d->shift);
+	return (*slot == NULL);
+}
+
+/* ************************************************** */
+/**
+ * @brief Takes a block out of the map, keeping it as spare if there's
+ * none yet.
+ * @param my_d Pointer to the deque.
+ * @param slot Map slot to empty.
+ */
+static void deque_block_put(deque_t *const my_d, void **slot){
+
+	if (my_d->spare == NULL){
+		my_d->spare = *slot;
+	} else {
+		free(*slot);
+	}
+	*slot = NULL;
+}
+
+/* ************************************************** */
+/**
+ * @brief Makes room for one more block before the first or after the
+ * last one in use. Blocks in use are moved to the middle of the map,
+ * which is doubled first if they take more than half of it. Only block
+ * pointers move, elements stay where they are.
+ * @param my_d Pointer to the deque, not empty.
+ * @return 0 if done, 1 if the map could not be grown.
+ */
+static unsigned char deque_map_room(deque_t *const my_d){
+
+	size_t first = my_d->start >> my_d->shift;
+	size_t used = ((my_d->start + my_d->size - 1) >> my_d->shift) -
+			first + 1;
+	size_t new_first;
+	unsigned int new_size = my_d->map_size;
+	void **new_map = my_d->map;
+	unsigned char grown = 0;
+
+	if (2 * (used + 1) > new_size){
+		if (new_size > ~0u / 2){
+			return 1;
+		}
+		new_size *= 2;
+		new_map = calloc(new_size, sizeof(void *));
+		if (new_map == NULL){
+			return 1;
+		}
+		grown = 1;
+	}
+
+	new_first = (new_size - used) / 2;
+
+	if (new_map == my_d->map){
+		memmove(new_map + new_first, my_d->map + first,
+				used * sizeof(void *));
+		//Clear the slots left behind, outside the new range
+		if (new_first > first){
+			memset(my_d->map + first, 0, (new_first - first) *
+					sizeof(void *));
+		} else {
+			memset(my_d->map + new_first + used, 0, (first - new_first) *
+					sizeof(void *));
+		}
+	} else {
+		memcpy(new_map + new_first, my_d->map + first,
+				used * sizeof(void *));
+		free(my_d->map);
+	}
+
+	my_d->map = new_map;
+	my_d->map_size = new_size;
+	my_d->start = (new_first << my_d->shift) +
+			(my_d->start & (((size_t) 1 << my_d->shift) - 1));
+
+	if (grown){
+		ds_stat_resize(my_d, (size_t) new_size << my_d->shift,
+				used * sizeof(void *));
+	} else {
+		ds_stat_copy(my_d, used * sizeof(void *));
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * @brief Called after a pop. Releases the block of the popped element
+ * if it holds no element anymore, and takes an emptied deque back to the
+ * middle of the map.
+ * @param my_d Pointer to the deque.
+ * @param off Offset of the popped element.
+ */
+static void deque_release(deque_t *const my_d, size_t off){
+
+	size_t blk = off >> my_d->shift;
+
+	if (my_d->size == 0){
+		deque_block_put(my_d, &my_d->map[blk]);
+		my_d->start = deque_middle(my_d);
+	} else if (blk != (my_d->start >> my_d->shift) &&
+			blk != ((my_d->start + my_d->size - 1) >> my_d->shift)){
+		deque_block_put(my_d, &my_d->map[blk]);
+	}
+}
+
+/* ************************************************** */
+
+void deque_init(deque_t *const my_d, size_t size){
+
+	size_t elm = DEQUE_BLOCK_BYTES / size;
+
+	my_d->el_size = size;
+	my_d->shift = 0;
+	while (((size_t) 2 << my_d->shift) <= elm){
+		++my_d->shift; //Biggest power of 2 fitting the target
+	}
+	while (((size_t) 1 << my_d->shift) < DEQUE_MIN_BLOCK_ELM){
+		++my_d->shift;
+	}
+
+	my_d->map = calloc(DEFAULT_DEQUE_MAP, sizeof(void *));
+	my_d->map_size = (my_d->map == NULL) ? 0 : DEFAULT_DEQUE_MAP;
+	my_d->spare = NULL;
+	my_d->size = 0;
+	my_d->start = deque_middle(my_d);
+	ds_stat_init(my_d, (size_t) my_d->map_size << my_d->shift);
+}
+
+/* ************************************************** */
+
+void deque_destroy(deque_t *const my_d){
+
+	unsigned int i;
+
+	for (i = 0; i < my_d->map_size; ++i){
+		free(my_d->map[i]);
+	}
+
+	free(my_d->map);
+	free(my_d->spare);
+}
+
+/* ************************************************** */
+
+unsigned char deque_push_back(deque_t *const my_d, const void *item){
+
+	size_t off = my_d->start + my_d->size;
+
+	if (my_d->map_size == 0){
+		return 1;
+	}
+
+	if ((off >> my_d->shift) == my_d->map_size){
+		if (deque_map_room(my_d)){
+			return 1;
+		}
+		off = my_d->start + my_d->size;
+	}
+
+	if (deque_block(my_d, off) == NULL &&
+			deque_block_get(my_d, &deque_block(my_d, off))){
+		return 1;
+	}
+
+	memcpy(deque_calc_address(my_d, off), item, my_d->el_size);
+	++my_d->size;
+	ds_stat_push(my_d, 1, my_d->size);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char deque_push_front(deque_t *const my_d, const void *item){
+
+	size_t off;
+
+	if (my_d->map_size == 0){
+		return 1;
+	}
+
+	if (my_d->start == 0 && deque_map_room(my_d)){
+		return 1;
+	}
+
+	off = my_d->start - 1;
+	if (deque_block(my_d, off) == NULL &&
+			deque_block_get(my_d, &deque_block(my_d, off))){
+		return 1;
+	}
+
+	memcpy(deque_calc_address(my_d, off), item, my_d->el_size);
+	my_d->start = off;
+	++my_d->size;
+	ds_stat_push(my_d, 1, my_d->size);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned int deque_pop_back(deque_t *const my_d, void *item){
+
+	size_t off = my_d->start + my_d->size - 1;
+
+	if (deque_empty(my_d)){
+		return 0;
+	}
+
+	if (item != NULL){
+		memcpy(item, deque_calc_address(my_d, off), my_d->el_size);
+	}
+
+	--my_d->size;
+	ds_stat_pop(my_d, 1);
+	deque_release(my_d, off);
+
+	return my_d->size;
+}
+
+/* ************************************************** */
+
+unsigned int deque_pop_front(deque_t *const my_d, void *item){
+
+	size_t off = my_d->start;
+
+	if (deque_empty(my_d)){
+		return 0;
+	}
+
+	if (item != NULL){
+		memcpy(item, deque_calc_address(my_d, off), my_d->el_size);
+	}
+
+	++my_d->start;
+	--my_d->size;
+	ds_stat_pop(my_d, 1);
+	deque_release(my_d, off);
+
+	return my_d->size;
+}
+
+/* ************************************************** */
+
+unsigned int deque_front(deque_t *const my_d, void *item){
+
+	if (!deque_empty(my_d)){
+		memcpy(item, deque_calc_address(my_d, my_d->start), my_d->el_size);
+	}
+
+	return my_d->size;
+}
+
+/* ************************************************** */
+
+unsigned int deque_back(deque_t *const my_d, void *item){
+
+	if (!deque_empty(my_d)){
+		memcpy(item, deque_calc_address(my_d, my_d->start + my_d->size - 1),
+				my_d->el_size);
+	}
+
+	return my_d->size;
+}
+
+/* ************************************************** */
+
+void *deque_at(deque_t *const my_d, unsigned int indx){
+
+	if (indx >= my_d->size){
+		return NULL;
+	}
+
+	return deque_calc_address(my_d, my_d->start + indx);
+}
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void deque_stats_dump(deque_t *const my_d, FILE *f){
+	ds_stats_dump(&my_d->stats, "deque", my_d->size, f);
+}
+
+/* ************************************************** */
+
+void deque_set_resize_hook(deque_t *const my_d, ds_resize_hook_t hook){
+	my_d->stats.on_resize = hook;
+}
+
+#endif
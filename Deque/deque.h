@@ -0,0 +1,160 @@
+
+/**
+ * @file deque.h
+ * @author Juan Manuel Torres Palma
+ * @brief Generic C double ended queue declaration file
+ */
+
+#ifndef DEQUE_H_
+#define DEQUE_H_
+
+#include <stdlib.h> // For size_t
+#include "stats.h" // For the DS_STATS counters
+
+/*
+ * @brief A generic double ended queue built from fixed size blocks and a
+ * map of pointers to them. Elements are addressed by an offset from the
+ * start of the first map slot, split into block and position inside the
+ * block, so indexing is O(1). Growing at either end allocates one more
+ * block, and only the map, never the elements, is moved when it runs out
+ * of slots.
+ * @var map Array of block pointers, NULL for blocks not in use.
+ * @var spare Last block released, kept to avoid malloc and free when
+ * the ends go back and forth across a block boundary.
+ * @var el_size Size of each element in the deque. Should be constant.
+ * @var start Offset of the first element.
+ * @var size Current number of elements.
+ * @var map_size Number of slots in the map.
+ * @var shift Log 2 of the elements per block.
+ * @var stats Counters, only in DS_STATS builds. Capacity is the elements
+ * the map can address, and resize bytes the block pointers moved.
+ */
+typedef struct deque{
+	void **map;				/* Block pointers */
+	void *spare;			/* Cached free block */
+	size_t el_size;			/* Element size. Should be constant */
+	size_t start;			/* Offset of the front element */
+	unsigned int size;		/* Number of elements */
+	unsigned int map_size;	/* Slots in map */
+	unsigned char shift;	/* Elements per block = 1 << shift */
+	DS_STATS_FIELD
+} deque_t;
+
+/*
+ * @brief Initialize a new deque. Blocks are about 4 KiB.
+ * @param [in] my_d Pointer to the deque to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @code
+ * 		deque_init(&d, sizeof(int));
+ * @endcode
+ */
+void deque_init(deque_t *const my_d, size_t size);
+
+/*
+ * @brief Destroy the deque and free its resources.
+ * @param my_d Pointer to the deque to be freed up.
+ */
+void deque_destroy(deque_t *const my_d);
+
+/*
+ * @brief Adds a new element at the end of the deque.
+ * @param [in] my_d Pointer to the deque where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Could not allocate a block or the map, nothing pushed.
+ */
+unsigned char deque_push_back(deque_t *const my_d, const void *item);
+
+/*
+ * @brief Adds a new element at the front of the deque.
+ * @param [in] my_d Pointer to the deque where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Could not allocate a block or the map, nothing pushed.
+ */
+unsigned char deque_push_front(deque_t *const my_d, const void *item);
+
+/*
+ * @brief Removes the last element of the deque.
+ * @param [in] my_d Pointer to the deque to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Number of elements remaining in the deque.
+ */
+unsigned int deque_pop_back(deque_t *const my_d, void *item);
+
+/*
+ * @brief Removes the first element of the deque.
+ * @param [in] my_d Pointer to the deque to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Number of elements remaining in the deque.
+ */
+unsigned int deque_pop_front(deque_t *const my_d, void *item);
+
+/*
+ * @brief Gets the first element of the deque.
+ * @param [in] my_d Pointer to the deque to be checked.
+ * @param [out] item Pointer to store the value.
+ * @return Number of elements in the deque.
+ */
+unsigned int deque_front(deque_t *const my_d, void *item);
+
+/*
+ * @brief Gets the last element of the deque.
+ * @param [in] my_d Pointer to the deque to be checked.
+ * @param [out] item Pointer to store the value.
+ * @return Number of elements in the deque.
+ */
+unsigned int deque_back(deque_t *const my_d, void *item);
+
+/*
+ * @brief Gets an element by position, in place. The pointer stays valid
+ * until that element is popped: pushes never move elements.
+ * @param [in] my_d Pointer to the deque to be checked.
+ * @param [in] indx Position from the front, 0 being the first.
+ * @return Pointer to the element.
+ * @retval NULL Position out of range.
+ */
+void *deque_at(deque_t *const my_d, unsigned int indx);
+
+/*
+ * @brief Checks if the deque is empty.
+ * @param [in] my_d Pointer to the deque to be checked.
+ * @return State of the deque.
+ * @retval 1 Empty deque.
+ * @retval 0 Not empty deque.
+ */
+static inline unsigned char deque_empty(deque_t *const my_d)
+{
+	return (my_d->size == 0);
+}
+
+/*
+ * @brief Returns the number of allocated items.
+ * @param [in] my_d Pointer to the deque to be checked.
+ * @return Number of items in the deque.
+ */
+static inline unsigned int deque_size(deque_t *const my_d)
+{
+	return my_d->size;
+}
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the deque counters to a stream, as one JSON line.
+ * @param [in] my_d Pointer to the deque.
+ * @param [in] f Stream to write to.
+ */
+void deque_stats_dump(deque_t *const my_d, FILE *f);
+
+/*
+ * @brief Sets a function to be called every time the map grows, with
+ * the old and new capacity.
+ * @param [in] my_d Pointer to the deque.
+ * @param [in] hook Function to call, NULL for none.
+ */
+void deque_set_resize_hook(deque_t *const my_d, ds_resize_hook_t hook);
+#endif
+
+#endif /* DEQUE_H_ */
@@ -0,0 +1,40 @@
+#include "deque.h"
+#include <stdio.h>
+
+#define DATA_TYPE char
+
+int main (int argc, char *argv[]){
+
+	unsigned i;
+	deque_t s;
+	DATA_TYPE *a = "Hi_my_friend" ;
+	DATA_TYPE *c = "Other" ;
+	DATA_TYPE b;
+
+	deque_init(&s, sizeof(DATA_TYPE));
+
+	for (i = 0; i < 12; ++i){
+		deque_push_back(&s, &(a[i]));
+	}
+
+	//Front pushes go backwards: "rehtOHi_my_friend"
+	for (i = 0; i < 5; ++i){
+		deque_push_front(&s, &(c[i]));
+	}
+
+	printf("%c\n", *(DATA_TYPE *) deque_at(&s, 5));
+
+	deque_pop_back(&s, NULL);
+
+	while (!deque_empty(&s)){
+		deque_pop_front(&s, &b);
+		printf("%c, %u\n", b, deque_size(&s));
+	}
+
+#ifdef DS_STATS
+	deque_stats_dump(&s, stdout);
+#endif
+	deque_destroy(&s);
+	
+	return 0;
+}
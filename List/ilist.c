@@ -0,0 +1,34 @@
+#include <stdlib.h> /* For NULL */
+#include "ilist.h"
+
+/* ************************************************** */
+
+list_link_t *ilist_search_by(ilist_t *const my_l, const void *key,
+		ilist_cmp_t cmp){
+
+	list_link_t *it;
+
+	ilist_for_each(my_l, it){
+		if (cmp(it, key) == 0){
+			return it;
+		}
+	}
+
+	return NULL;
+}
+
+/* ************************************************** */
+/**
+ * Every link is reset, so the structs can tell they're out with
+ * ilist_linked and go into another list right away.
+ */
+void ilist_clear(ilist_t *const my_l){
+
+	list_link_t *it, *nx;
+
+	ilist_for_each_safe(my_l, it, nx){
+		ilist_link_init(it);
+	}
+
+	ilist_init(my_l);
+}
@@ -0,0 +1,267 @@
+/**
+ * @file ilist.h
+ * @author Juan Manuel Torres Palma
+ * @brief Generic C intrusive list declaration file
+ */
+
+#ifndef ILIST_H_
+#define ILIST_H_
+
+#include <stddef.h> // For offsetof
+
+/*
+ * @brief Links embedded in a user struct to chain it in an ilist_t. A
+ * struct can sit on as many lists at once as links it embeds. An unlinked
+ * link points to itself.
+ * @var next Next link, or the list sentinel after the last one.
+ * @var prev Previous link, or the list sentinel before the first one.
+ */
+typedef struct list_link{
+	struct list_link *next;
+	struct list_link *prev;
+} list_link_t;
+
+/*
+ * @brief A double linked list of structs owned by the caller, chained
+ * through a list_link_t inside them. Same sentinel scheme as list_t, but
+ * the list never allocates, frees or copies anything: inserting and
+ * removing is relinking, O(1). The sentinel is embedded too, so the list
+ * must not be moved in memory while it has elements.
+ * @var sent Sentinel link, before the first and after the last one.
+ * @var size Current size of the list.
+ */
+typedef struct ilist{
+	list_link_t sent;	/* Sentinel, never a user struct */
+	unsigned int size;	/* Number of linked structs */
+} ilist_t;
+
+/*
+ * @brief Compares the struct of a link and a key.
+ * @return 0 if they match, other value if not, like memcmp.
+ */
+typedef int (*ilist_cmp_t)(const list_link_t *link, const void *key);
+
+/*
+ * @brief Gets the struct a link is embedded in.
+ * @param link Pointer to the link.
+ * @param type Type of the struct.
+ * @param member Name of the link field in the struct.
+ * @code
+ * 		conn_t *c = list_container_of(it, conn_t, lru);
+ * @endcode
+ */
+#define list_container_of(link, type, member)					\
+	((type *) ((unsigned char *) (link) - offsetof(type, member)))
+
+/*
+ * @brief Walks every link of a list, front to back. The link walked
+ * must not be removed inside the loop; see ilist_for_each_safe.
+ * @param l Pointer to the list.
+ * @param it list_link_t pointer set to each link.
+ */
+#define ilist_for_each(l, it)										\
+	for ((it) = (l)->sent.next; (it) != &(l)->sent; (it) = (it)->next)
+
+/*
+ * @brief Same as ilist_for_each, but the link walked can be removed, the
+ * next one being read before the loop body runs.
+ * @param l Pointer to the list.
+ * @param it list_link_t pointer set to each link.
+ * @param nx list_link_t pointer used to hold the next link.
+ */
+#define ilist_for_each_safe(l, it, nx)								\
+	for ((it) = (l)->sent.next, (nx) = (it)->next; (it) != &(l)->sent;	\
+			(it) = (nx), (nx) = (it)->next)
+
+/*
+ * @brief Finds the first struct matching a key, front to back.
+ * @param [in] my_l Pointer to the list to search in.
+ * @param [in] key Pointer to the key, passed to cmp.
+ * @param [in] cmp Comparison function, link first and key second.
+ * @return Link of the struct found.
+ * @retval NULL Not found.
+ */
+list_link_t *ilist_search_by(ilist_t *const my_l, const void *key,
+		ilist_cmp_t cmp);
+
+/*
+ * @brief Unlinks every struct, leaving each link unlinked and the list
+ * empty. O(n), the structs themselves are not touched otherwise.
+ * @param [in] my_l Pointer to the list.
+ */
+void ilist_clear(ilist_t *const my_l);
+
+/*
+ * @brief Initialize a new, empty list.
+ * @param [in] my_l Pointer to the list to be initialized.
+ */
+static inline void ilist_init(ilist_t *const my_l){
+	my_l->sent.next = &my_l->sent;
+	my_l->sent.prev = &my_l->sent;
+	my_l->size = 0;
+}
+
+/*
+ * @brief Marks a link as not in any list, so ilist_linked can tell.
+ * @param [in] link Pointer to the link.
+ */
+static inline void ilist_link_init(list_link_t *const link){
+	link->next = link;
+	link->prev = link;
+}
+
+/*
+ * @brief Checks if a link is in a list. Only for links set up with
+ * ilist_link_init, or removed with ilist_remove.
+ * @param [in] link Pointer to the link.
+ * @return 1 if linked, 0 if not.
+ */
+static inline unsigned char ilist_linked(const list_link_t *const link){
+	return link->next != link;
+}
+
+/*
+ * @brief Links a struct just before another one of the list.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] pos Link of the struct to insert before. The sentinel,
+ * &my_l->sent, appends at the end.
+ * @param [in] link Link of the struct to insert, not in this list.
+ */
+static inline void ilist_insert(ilist_t *const my_l, list_link_t *const pos,
+		list_link_t *const link){
+	link->next = pos;
+	link->prev = pos->prev;
+	pos->prev->next = link;
+	pos->prev = link;
+	++my_l->size;
+}
+
+/*
+ * @brief Links a struct at the end of the list.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] link Link of the struct to append.
+ */
+static inline void ilist_push_back(ilist_t *const my_l,
+		list_link_t *const link){
+	ilist_insert(my_l, &my_l->sent, link);
+}
+
+/*
+ * @brief Links a struct at the start of the list.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] link Link of the struct to prepend.
+ */
+static inline void ilist_push_front(ilist_t *const my_l,
+		list_link_t *const link){
+	ilist_insert(my_l, my_l->sent.next, link);
+}
+
+/*
+ * @brief Unlinks a struct from the list, leaving the link unlinked.
+ * @param [in] my_l Pointer to the list the struct is in.
+ * @param [in] link Link of the struct, not the sentinel.
+ */
+static inline void ilist_remove(ilist_t *const my_l, list_link_t *const link){
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	ilist_link_init(link);
+	--my_l->size;
+}
+
+/*
+ * @brief Unlinks the first struct of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return Link of the struct removed.
+ * @retval NULL Empty list.
+ */
+static inline list_link_t *ilist_pop_front(ilist_t *const my_l){
+
+	list_link_t *link = my_l->sent.next;
+
+	if (link == &my_l->sent){
+		return NULL;
+	}
+
+	ilist_remove(my_l, link);
+	return link;
+}
+
+/*
+ * @brief Unlinks the last struct of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return Link of the struct removed.
+ * @retval NULL Empty list.
+ */
+static inline list_link_t *ilist_pop_back(ilist_t *const my_l){
+
+	list_link_t *link = my_l->sent.prev;
+
+	if (link == &my_l->sent){
+		return NULL;
+	}
+
+	ilist_remove(my_l, link);
+	return link;
+}
+
+/*
+ * @brief Moves a struct of the list to its start, like an LRU touch.
+ * @param [in] my_l Pointer to the list the struct is in.
+ * @param [in] link Link of the struct.
+ */
+static inline void ilist_move_front(ilist_t *const my_l,
+		list_link_t *const link){
+	ilist_remove(my_l, link);
+	ilist_push_front(my_l, link);
+}
+
+/*
+ * @brief Moves a struct of the list to its end.
+ * @param [in] my_l Pointer to the list the struct is in.
+ * @param [in] link Link of the struct.
+ */
+static inline void ilist_move_back(ilist_t *const my_l,
+		list_link_t *const link){
+	ilist_remove(my_l, link);
+	ilist_push_back(my_l, link);
+}
+
+/*
+ * @brief Gets the first link of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return First link, NULL if empty.
+ */
+static inline list_link_t *ilist_front(ilist_t *const my_l){
+	return (my_l->size == 0) ? NULL : my_l->sent.next;
+}
+
+/*
+ * @brief Gets the last link of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return Last link, NULL if empty.
+ */
+static inline list_link_t *ilist_back(ilist_t *const my_l){
+	return (my_l->size == 0) ? NULL : my_l->sent.prev;
+}
+
+/*
+ * @brief Checks if the list is empty.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @return Status of the list.
+ * @retval 1 Empty list.
+ * @retval 0 Not empty list.
+ */
+static inline unsigned char ilist_empty(ilist_t *const my_l){
+	return (my_l->size == 0);
+}
+
+/*
+ * @brief Returns the number of linked structs.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @return Number of structs in the list.
+ */
+static inline unsigned int ilist_size(ilist_t *const my_l){
+	return my_l->size;
+}
+
+#endif /* ILIST_H_ */
@@ -1,20 +1,59 @@
 #include <stdlib.h> /* For malloc and free */
-#include <string.h> /* For memcpy */
+#include <stddef.h> /* For max_align_t */
+#include <string.h> /* For memcpy and memmove */
 #include "list.h"
+#include "snapshot.h" /* For the snapshot format */
+
+#define LIST_POOL_SLAB_NODES 256 /* Default node slots per slab */
+#define LIST_INDEX_SLOTS 16 /* Initial hash index slots, power of 2 */
+#define LIST_SORT_BINS 32 /* Merge sort runs, one per bit of the size */
+
+/* Alignment of node slots, the same malloc gives */
+#define LIST_POOL_ALIGN _Alignof(max_align_t)
 
 
 /*
  * @brief Internal node struct used in double linked list.
+ * The stored value lives inline after the links, so every node is a
+ * single allocation of sizeof(list_node_t) + el_size bytes. The
+ * sentinel comes from the same allocator, so it has room for a payload
+ * it never uses.
  * @var next Pointer to the next node in the list.
  * @var prev Pointer to the previous node.
- * @var data Pointer to the stored value.
+ * @var data Stored value, el_size bytes.
  */
 typedef struct list_node{
 	struct list_node *next;
 	struct list_node *prev;
-	void *data;
+	unsigned char data[];
 } list_node_t;
 
+/*
+ * @brief Entry of the hash index.
+ * @var hash Cached hash of the node element.
+ * @var node Indexed node, NULL for a free entry.
+ */
+typedef struct list_index_entry{
+	size_t hash;
+	list_node_t *node;
+} list_index_entry_t;
+
+/*
+ * @brief Open addressing hash table over the list nodes, with linear
+ * probing and at most half of the slots used.
+ * @var slots Entry array.
+ * @var mask Number of slots minus one, slots is a power of 2.
+ * @var count Number of used slots.
+ * @var hash Hash function of elements and keys.
+ * @var cmp Comparison function, element first and key second.
+ */
+struct list_index{
+	list_index_entry_t *slots;
+	size_t mask;
+	size_t count;
+	list_hash_t hash;
+	list_cmp_t cmp;
+};
 
 
 /* ************************************************** */
@@ -24,28 +63,221 @@ typedef struct list_node{
  */
 #define list_get_sent(l) ((list_node_t*) l->sent)
 
+/**
+ * @brief Macro to round a size up to the pool slot alignment.
+ * @param s Size in bytes.
+ */
+#define list_pool_round(s) \
+	(((s) + LIST_POOL_ALIGN - 1) & ~(size_t)(LIST_POOL_ALIGN - 1))
+
+/* ************************************************** */
+/**
+ * @brief Takes a node slot from the pool. Recycled slots are used first,
+ * then fresh slots from the newest slab, and only then a new slab is
+ * allocated. A slab starts with the pointer chaining it to the older ones.
+ * Pools over caller storage have no slab size and never grow.
+ * @var pool Pointer to the pool.
+ * @return Pointer to an uninitialized node slot, NULL if none left.
+ */
+static inline list_node_t *list_pool_get(list_pool_t *const pool)
+{
+	void *slot = pool->free_list;
+	unsigned char *slab;
+
+	if (slot != NULL){
+		pool->free_list = *(void **) slot; /* Unlink recycled slot */
+		return slot;
+	}
+
+	if (pool->bump == pool->bump_end){
+		if (pool->slab_nodes == 0){
+			return NULL;
+		}
+		slab = malloc(list_pool_round(sizeof(void *)) +
+				pool->node_size * pool->slab_nodes);
+		if (slab == NULL){
+			return NULL;
+		}
+		*(void **) slab = pool->slabs; /* Chain to the older slabs */
+		pool->slabs = slab;
+		pool->bump = slab + list_pool_round(sizeof(void *));
+		pool->bump_end = pool->bump + pool->node_size * pool->slab_nodes;
+	}
+
+	slot = pool->bump;
+	pool->bump += pool->node_size;
+	return slot;
+}
+
+/* ************************************************** */
+/**
+ * @brief Gives a node slot back to the pool. The free list is linked
+ * through the first word of the slot, which is the node next field, so
+ * a chain of nodes can be released at once.
+ * @var pool Pointer to the pool.
+ * @var n_ptr Pointer to the node.
+ */
+static inline void list_pool_put(list_pool_t *const pool,
+				list_node_t *const n_ptr)
+{
+	n_ptr->next = pool->free_list;
+	pool->free_list = n_ptr;
+}
+
+/* ************************************************** */
+/**
+ * @brief Puts a node in the first free slot of its probe sequence. There
+ * must be room for it.
+ * @var idx Pointer to the index.
+ * @var hash Hash of the node element.
+ * @var n_ptr Pointer to the node.
+ */
+static void list_index_put(struct list_index *const idx, size_t hash,
+				list_node_t *const n_ptr)
+{
+	size_t i = hash & idx->mask;
+
+	while (idx->slots[i].node != NULL){
+		i = (i + 1) & idx->mask;
+	}
+
+	idx->slots[i].hash = hash;
+	idx->slots[i].node = n_ptr;
+	++idx->count;
+}
+
+/* ************************************************** */
+/**
+ * @brief Makes sure n more nodes fit keeping the load under a half,
+ * doubling the table as many times as needed and reinserting with the
+ * cached hashes if not.
+ * @var my_l Pointer to the list, with an index.
+ * @var n Number of nodes about to be added.
+ * @return 0 if there's room, 1 if the table couldn't grow.
+ */
+static uint8_t list_index_reserve(list_t *const my_l, size_t n)
+{
+	struct list_index *const idx = my_l->index;
+	list_index_entry_t *old = idx->slots;
+	size_t old_slots = idx->mask + 1;
+	size_t slots = old_slots;
+	size_t i;
+
+	while ((idx->count + n) * 2 > slots){
+		slots <<= 1;
+	}
+
+	if (slots == old_slots){
+		return 0;
+	}
+
+	idx->slots = calloc(slots, sizeof(list_index_entry_t));
+	if (idx->slots == NULL){
+		idx->slots = old;
+		return 1;
+	}
+
+	idx->mask = slots - 1;
+	idx->count = 0;
+
+	for (i = 0; i < old_slots; ++i){
+		if (old[i].node != NULL){
+			list_index_put(idx, old[i].hash, old[i].node);
+		}
+	}
+
+	free(old);
+	ds_stat_resize(my_l, idx->mask + 1,
+			idx->count * sizeof(list_index_entry_t));
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * @brief Removes a node from the index. Entries after it in the same
+ * probe run are shifted back, so lookups never need tombstones.
+ * @var idx Pointer to the index.
+ * @var n_ptr Pointer to the node, which must be indexed.
+ */
+static void list_index_remove(struct list_index *const idx,
+				list_node_t *const n_ptr)
+{
+	size_t i = idx->hash(n_ptr->data) & idx->mask;
+	size_t j, home;
+
+	while (idx->slots[i].node != n_ptr){
+		i = (i + 1) & idx->mask;
+	}
+
+	/* i is the hole, j looks for an entry that may move into it */
+	for (j = (i + 1) & idx->mask; idx->slots[j].node != NULL;
+			j = (j + 1) & idx->mask){
+		home = idx->slots[j].hash & idx->mask;
+		/* Movable unless its home lies cyclically in (i, j] */
+		if (((j - home) & idx->mask) >= ((j - i) & idx->mask)){
+			idx->slots[i] = idx->slots[j];
+			i = j;
+		}
+	}
+
+	idx->slots[i].node = NULL;
+	--idx->count;
+}
+
+/* ************************************************** */
+/**
+ * @brief Allocates a node, with room for the payload, from the list
+ * allocator.
+ * @var my_l Pointer to the list.
+ * @return Pointer to the new node, uninitialized.
+ */
+static inline list_node_t *list_node_alloc(list_t *const my_l)
+{
+	if (my_l->pool == NULL){
+		/* Header and payload in one block */
+		return malloc(sizeof(list_node_t) + my_l->el_size);
+	}
+
+	return list_pool_get(my_l->pool);
+}
+
 /* ************************************************** */
 /**
  * @brief Function to easily create new nodes.
+ * @var my_l Pointer to the list the node belongs to.
  * @var prev Pointer to the previous node.
  * @var next Pointer to the next node.
- * @var data_s Size of data field.
  * @var item Pointer to item to be copied.
- * @return Pointer to the new node.
+ * @return Pointer to the new node, NULL if it couldn't be allocated.
  */
-static inline list_node_t *list_node_create(list_node_t *const prev,
-				list_node_t *const next, size_t data_s, void *item){
+static inline list_node_t *list_node_create(list_t *const my_l,
+				list_node_t *const prev, list_node_t *const next, void *item){
 	
-	list_node_t *temp_ptr = malloc(sizeof(list_node_t));
+	list_node_t *temp_ptr;
+
+	/* Room in the index first, nothing to undo if it fails */
+	if (my_l->index != NULL && list_index_reserve(my_l, 1)){
+		return NULL;
+	}
+
+	temp_ptr = list_node_alloc(my_l);
+	if (temp_ptr == NULL){
+		return NULL;
+	}
 
 	temp_ptr->next = next; /* Chained to the next node */
 	temp_ptr->prev = prev; /* Chained to the previous node */
-	temp_ptr->data = malloc(data_s);
-	memcpy(temp_ptr->data, item, data_s); /* Assign data */
+	memcpy(temp_ptr->data, item, my_l->el_size); /* Assign data */
 
 	/* Update nodes around */
 	prev->next = temp_ptr; /* Previous points to current */
 	next->prev = temp_ptr; /* Next points to current */
+	ds_stat_push(my_l, 1, my_l->size + 1);
+
+	if (my_l->index != NULL){
+		list_index_put(my_l->index, my_l->index->hash(temp_ptr->data),
+				temp_ptr);
+	}
 	
 
 	return temp_ptr;
@@ -56,35 +288,194 @@ static inline list_node_t *list_node_create(list_node_t *const prev,
 /**
  * @brief Function to easily destroy nodes. Links next and previous nodes,
  * so it's useful in almost all functions.
+ * @var my_l Pointer to the list the node belongs to.
  * @var n_ptr Pointer to the node.
  */
-static inline void list_node_destroy(list_node_t *const n_ptr)
+static inline void list_node_destroy(list_t *const my_l,
+				list_node_t *const n_ptr)
 {
 	n_ptr->prev->next = n_ptr->next; /* Previous node points to next*/
 	n_ptr->next->prev = n_ptr->prev; /* Next points to previous */
-	free(n_ptr->data);
-	free(n_ptr);
+
+	if (my_l->index != NULL){
+		list_index_remove(my_l->index, n_ptr);
+	}
+	ds_stat_pop(my_l, 1);
+
+	if (my_l->pool == NULL){
+		free(n_ptr); /* Payload goes with the node */
+	} else {
+		list_pool_put(my_l->pool, n_ptr);
+	}
 }
 
 /* ************************************************** */
-
-void list_init(list_t *const my_l, size_t size)
+/**
+ * @brief Sets up the list fields and its sentinel, taken from the list
+ * allocator so a pooled list owns no malloc'ed block.
+ * @var my_l Pointer to the list.
+ * @var size Size in bytes of a single element.
+ * @var pool Node allocator, NULL for malloc.
+ * @var own_pool Set if the pool belongs to this list.
+ * @return 0 if done, 1 if the sentinel couldn't be allocated, with sent
+ * left NULL.
+ */
+static uint8_t list_setup(list_t *const my_l, size_t size,
+				list_pool_t *const pool, uint8_t own_pool)
 {
-	list_node_t *sent = malloc(sizeof(list_node_t));
-	sent->next = sent; /* Points to itself */
-	sent->prev = sent;
+	list_node_t *sent;
 
 	my_l->el_size = size; /* Data size */
 	my_l->size = 0; 	  /* Zero elements initially */	
+	my_l->pool = pool;
+	my_l->own_pool = own_pool;
+	my_l->index = NULL;
+	ds_stat_init(my_l, 0);
+
+	sent = list_node_alloc(my_l);
 	my_l->sent = sent;    /* Sentinel */
+	if (sent == NULL){
+		return 1;
+	}
+
+	sent->next = sent; /* Points to itself */
+	sent->prev = sent;
+	return 0;
+}
+
+/* ************************************************** */
+
+uint8_t list_init(list_t *const my_l, size_t size)
+{
+	return list_setup(my_l, size, NULL, 0);
+}
+
+/* ************************************************** */
+/**
+ * A pool that fails to get its first slab has nothing to release but
+ * itself.
+ */
+uint8_t list_init_pooled(list_t *const my_l, size_t size,
+		uint32_t slab_nodes)
+{
+	list_pool_t *pool = malloc(sizeof(list_pool_t));
+
+	if (pool == NULL){
+		my_l->sent = NULL;
+		my_l->pool = NULL;
+		my_l->index = NULL;
+		return 1;
+	}
+
+	list_pool_init(pool, size, slab_nodes);
+	if (list_setup(my_l, size, pool, 1)){
+		free(pool);
+		my_l->pool = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+uint8_t list_init_shared(list_t *const my_l, list_pool_t *const pool)
+{
+	return list_setup(my_l, pool->el_size, pool, 0);
+}
+
+/* ************************************************** */
+/**
+ * The pool header is carved out of the start of the buffer, and the rest
+ * is handed to the pool as its only slab, not chained so it's never freed.
+ * The buffer must hold at least the header and the sentinel.
+ */
+uint8_t list_init_static(list_t *const my_l, size_t size, void *buf,
+		size_t buf_size)
+{
+	unsigned char *start = (unsigned char *) list_pool_round((uintptr_t) buf);
+	unsigned char *end = (unsigned char *) buf + buf_size;
+	size_t header = (start - (unsigned char *) buf) +
+			list_pool_round(sizeof(list_pool_t));
+	list_pool_t *pool = (list_pool_t *) start;
+
+	if (buf_size < header || buf_size - header < LIST_NODE_BYTES(size)){
+		my_l->sent = NULL;
+		my_l->pool = NULL;
+		my_l->index = NULL;
+		return 1;
+	}
+
+	list_pool_init(pool, size, 0);
+	pool->slab_nodes = 0; /* Never grow */
+	pool->bump = start + list_pool_round(sizeof(list_pool_t));
+	pool->bump_end = pool->bump +
+			(end - pool->bump) / pool->node_size * pool->node_size;
+
+	return list_setup(my_l, size, pool, 0);
+}
+
+/* ************************************************** */
+/**
+ * No slab is allocated until the first node is requested.
+ */
+void list_pool_init(list_pool_t *const pool, size_t size,
+		uint32_t slab_nodes)
+{
+	pool->slabs = NULL;
+	pool->free_list = NULL;
+	pool->bump = NULL;
+	pool->bump_end = NULL;
+	pool->el_size = size;
+	pool->node_size = LIST_NODE_BYTES(size);
+	pool->slab_nodes = slab_nodes ? slab_nodes : LIST_POOL_SLAB_NODES;
+}
+
+/* ************************************************** */
+
+void list_pool_destroy(list_pool_t *const pool)
+{
+	void *slab = pool->slabs;
+	void *next_slab;
+
+	while (slab != NULL){
+		next_slab = *(void **) slab;
+		free(slab);
+		slab = next_slab;
+	}
+
+	pool->slabs = NULL;
+	pool->free_list = NULL;
+	pool->bump = NULL;
+	pool->bump_end = NULL;
 }
 
 /* ************************************************** */
 /**
- * Starts destroying from head to the last node.
+ * Starts destroying from head to the last node. Pooled lists don't walk
+ * the nodes: a private pool is dropped slab by slab, and for a shared
+ * pool the whole ring, sentinel first, is already chained through next,
+ * so it's pushed onto the free list at once.
  */
 void list_destroy(list_t *const my_list)
 {
+	if (my_list->sent == NULL){
+		return; /* Failed init, nothing was allocated */
+	}
+
+	list_index_destroy(my_list);
+
+	if (my_list->pool != NULL){
+		if (my_list->own_pool){
+			list_pool_destroy(my_list->pool);
+			free(my_list->pool);
+		} else {
+			list_get_sent(my_list)->prev->next = my_list->pool->free_list;
+			my_list->pool->free_list = my_list->sent;
+		}
+		return;
+	}
+
 	/* Stores pointer to node to remove */
 	list_node_t *dptr = list_get_sent(my_list)->next;
 	/* Stores pointer to next node to remove */
@@ -94,8 +485,7 @@ void list_destroy(list_t *const my_list)
 
 	while (dptr != my_list->sent){
 		ndptr = dptr->next; 	/* Save next pointer */
-		free(dptr->data);		/* Destroy node */
-		free(dptr);
+		free(dptr);				/* Destroy node and payload */
 		dptr = ndptr;			/* Point to next node */
 	}
 
@@ -105,12 +495,14 @@ void list_destroy(list_t *const my_list)
 /**
  * We can always push elements into the list.
  */
-void list_push_back(list_t *const my_list, void *item)
+uint8_t list_push_back(list_t *const my_list, void *item)
 {
 	/* List tail node*/
 	list_node_t *tail = list_get_sent(my_list)->prev;
 	/* Create new node and add it at the end */
-	list_node_create(tail, my_list->sent, my_list->el_size, item);
+	if (list_node_create(my_list, tail, my_list->sent, item) == NULL){
+		return 1;
+	}
 
 
 	/* At this point the new node is complete, and those surrounding
@@ -119,6 +511,7 @@ void list_push_back(list_t *const my_list, void *item)
 	/* Increase size */
 	++(my_list->size);
 
+	return 0;
 }
 
 /* ************************************************** */
@@ -142,7 +535,7 @@ uint32_t list_pop_back(list_t *const my_list, void *item)
 	}
 
 	/* Delete node*/
-	list_node_destroy(tail);
+	list_node_destroy(my_list, tail);
 
 	return --my_list->size;
 
@@ -150,13 +543,15 @@ uint32_t list_pop_back(list_t *const my_list, void *item)
 
 /* ************************************************** */
 
-void list_push_front(list_t *const my_list, void *item)
+uint8_t list_push_front(list_t *const my_list, void *item)
 {
 	
 	/* List head */
 	list_node_t *head = list_get_sent(my_list)->next;
 	/* Create new node */
-	list_node_create(my_list->sent, head, my_list->el_size, item);
+	if (list_node_create(my_list, my_list->sent, head, item) == NULL){
+		return 1;
+	}
 	
 		
 	/* At this point the new node is complete */
@@ -164,6 +559,7 @@ void list_push_front(list_t *const my_list, void *item)
 	/* Increase size */
 	++(my_list->size);
 
+	return 0;
 }
 
 
@@ -185,7 +581,7 @@ uint32_t list_pop_front(list_t *const my_list, void *item)
 	}
 
 	/* Delete node*/
-	list_node_destroy(head);
+	list_node_destroy(my_list, head);
 
 	return --my_list->size;
 
@@ -240,9 +636,8 @@ list_iterator_t list_end(list_t *const my_l)
 
 /* ************************************************** */
 /**
- * Compares data in nodes with s_itm. To compare uses memcmp. However,
- * there's a possibility to use a function pointer to let the user
- * set the way 2 elements are compared. That last is not implemented.
+ * Compares data in nodes with s_itm. To compare uses memcmp. To let the
+ * user set the way 2 elements are compared, see list_search_by.
  */
 list_iterator_t list_search(list_t *const my_list, void *const s_itm)
 {
@@ -254,6 +649,7 @@ list_iterator_t list_search(list_t *const my_list, void *const s_itm)
 	while (s_ptr != my_list->sent && !found){
 		/* memcmp returns 0 if equal!! */
 		found = !memcmp(s_ptr->data, s_itm, my_list->el_size);
+		ds_stat_cmp(my_list, 1);
 		s_ptr = s_ptr->next;
 	}
 
@@ -265,20 +661,126 @@ list_iterator_t list_search(list_t *const my_list, void *const s_itm)
 
 }
 
+/* ************************************************** */
+
+list_iterator_t list_search_by(list_t *const my_list, const void *key,
+		list_cmp_t cmp)
+{
+	list_node_t *s_ptr = list_get_sent(my_list)->next;
+
+	while (s_ptr != my_list->sent){
+		ds_stat_cmp(my_list, 1);
+		if (cmp(s_ptr->data, key) == 0){
+			return s_ptr;
+		}
+		s_ptr = s_ptr->next;
+	}
+
+	return NULL;
+}
+
+/* ************************************************** */
+/**
+ * The table starts with room for the current elements at half load.
+ */
+uint8_t list_index_init(list_t *const my_list, list_hash_t hash,
+		list_cmp_t cmp)
+{
+	struct list_index *idx;
+	list_node_t *n_ptr;
+	size_t slots = LIST_INDEX_SLOTS;
+
+	list_index_destroy(my_list);
+
+	while (slots < (size_t) my_list->size * 2 + 2){
+		slots <<= 1;
+	}
+
+	idx = malloc(sizeof(struct list_index));
+	if (idx == NULL){
+		return 1;
+	}
+
+	idx->slots = calloc(slots, sizeof(list_index_entry_t));
+	if (idx->slots == NULL){
+		free(idx);
+		return 1;
+	}
+
+	idx->mask = slots - 1;
+	idx->count = 0;
+	idx->hash = hash;
+	idx->cmp = cmp;
+
+	for (n_ptr = list_get_sent(my_list)->next; n_ptr != my_list->sent;
+			n_ptr = n_ptr->next){
+		list_index_put(idx, hash(n_ptr->data), n_ptr);
+	}
+
+	my_list->index = idx;
+	ds_stat_resize(my_list, slots, 0);
+	return 0;
+}
+
+/* ************************************************** */
+
+void list_index_destroy(list_t *const my_list)
+{
+	if (my_list->index != NULL){
+		free(my_list->index->slots);
+		free(my_list->index);
+		my_list->index = NULL;
+		ds_stat_resize(my_list, 0, 0);
+	}
+}
+
+/* ************************************************** */
+/**
+ * Only entries with the same hash get compared, so the comparator runs
+ * about once per lookup.
+ */
+list_iterator_t list_lookup(list_t *const my_list, const void *key)
+{
+	struct list_index *idx = my_list->index;
+	size_t hash, i;
+
+	if (idx == NULL){
+		return list_search(my_list, (void *) key);
+	}
+
+	hash = idx->hash(key);
+
+	for (i = hash & idx->mask; idx->slots[i].node != NULL;
+			i = (i + 1) & idx->mask){
+		if (idx->slots[i].hash != hash){
+			continue;
+		}
+		ds_stat_cmp(my_list, 1);
+		if (idx->cmp(idx->slots[i].node->data, key) == 0){
+			return idx->slots[i].node;
+		}
+	}
+
+	return NULL;
+}
+
 /* ************************************************** */
 /**
  * Inserts a new node in the position given by indx. Is inserted just
  * before the node pointed by indx, so the new node next will point
  * to indx.
  */
-void list_insert(list_t *const my_list, 
+uint8_t list_insert(list_t *const my_list, 
 		const list_iterator_t indx,	void *const item)
 {
 	list_node_t *curr_node = (list_node_t *) indx;
 	/* Create node in the desired position */
-	list_node_create(curr_node->prev, indx, my_list->el_size, item);
+	if (list_node_create(my_list, curr_node->prev, indx, item) == NULL){
+		return 1;
+	}
 	++my_list->size;
 	
+	return 0;
 }
 
 /* ************************************************** */
@@ -294,11 +796,236 @@ void list_delete(list_t *const my_list, const list_iterator_t indx)
 	}
 
 	/* Destroy node */
-	list_node_destroy(indx);
+	list_node_destroy(my_list, indx);
 	--my_list->size;
 	
 }
 
+/* ************************************************** */
+/**
+ * @brief Counts the nodes from n_ptr to the back of the list, walking
+ * both ways at once so it takes as many steps as the shorter side.
+ * @var my_l Pointer to the list.
+ * @var n_ptr Pointer to a node of the list, or the sentinel.
+ * @return Nodes from n_ptr, included, to the back.
+ */
+static uint32_t list_tail_size(list_t *const my_l, list_node_t *n_ptr)
+{
+	list_node_t *fwd = n_ptr, *bwd = n_ptr->prev;
+	uint32_t k = 0;
+
+	while (fwd != my_l->sent && bwd != my_l->sent){
+		fwd = fwd->next;
+		bwd = bwd->prev;
+		++k;
+	}
+
+	return (fwd == my_l->sent) ? k : my_l->size - k;
+}
+
+/* ************************************************** */
+/**
+ * @brief Counts the nodes from first to last, both included. Ranges
+ * reaching an end of the list are measured from the closest end.
+ * @var my_l Pointer to the list.
+ * @var first Pointer to the first node of the range.
+ * @var last Pointer to the last node of the range.
+ * @return Nodes in the range.
+ */
+static uint32_t list_range_size(list_t *const my_l, list_node_t *first,
+				list_node_t *const last)
+{
+	uint32_t k = 1;
+
+	if (last->next == my_l->sent){
+		return list_tail_size(my_l, first);
+	}
+
+	if (first->prev == my_l->sent){
+		return my_l->size - list_tail_size(my_l, last->next);
+	}
+
+	for (; first != last; first = first->next){
+		++k;
+	}
+
+	return k;
+}
+
+/* ************************************************** */
+/**
+ * Nodes are relinked, not copied, so they have to come from the same
+ * allocator: both lists on malloc, or both on the same shared pool.
+ * Private and static pools go away with their list, so their nodes can
+ * only be moved inside it. With no index on either list, moving a whole
+ * list, or within a list, is O(1), and a range is counted from the
+ * closest end of src. Indexed lists have each node moved from one index
+ * to the other, with room made in dst before anything is relinked.
+ */
+uint8_t list_splice(list_t *const dst, const list_iterator_t pos,
+		list_t *const src, const list_iterator_t first,
+		const list_iterator_t last)
+{
+	list_node_t *f = first, *l = last, *n_ptr;
+	list_node_t *p = (pos != NULL) ? pos : dst->sent;
+	uint32_t count;
+
+	if (dst->pool != src->pool || dst->el_size != src->el_size){
+		return 1;
+	}
+
+	if (first == NULL || first == src->sent || list_empty(src) ||
+			(dst == src && (p == f || p == l->next))){
+		return 0; /* Nothing to move, or already in place */
+	}
+
+	if (dst != src){
+		count = list_range_size(src, f, l);
+
+		if (dst->index != NULL && list_index_reserve(dst, count)){
+			return 1;
+		}
+
+		if (src->index != NULL || dst->index != NULL){
+			for (n_ptr = f; ; n_ptr = n_ptr->next){
+				if (src->index != NULL){
+					list_index_remove(src->index, n_ptr);
+				}
+				if (dst->index != NULL){
+					list_index_put(dst->index, dst->index->hash(n_ptr->data),
+							n_ptr);
+				}
+				if (n_ptr == l){
+					break;
+				}
+			}
+		}
+
+		src->size -= count;
+		dst->size += count;
+		ds_stat_pop(src, count);
+		ds_stat_push(dst, count, dst->size);
+	}
+
+	/* Unlink the range from src */
+	f->prev->next = l->next;
+	l->next->prev = f->prev;
+
+	/* And link it before p */
+	f->prev = p->prev;
+	l->next = p;
+	p->prev->next = f;
+	p->prev = l;
+
+	return 0;
+}
+
+/* ************************************************** */
+
+uint8_t list_concat(list_t *const dst, list_t *const src)
+{
+	return list_splice(dst, NULL, src, list_begin(src), list_end(src));
+}
+
+/* ************************************************** */
+
+uint8_t list_split_at(list_t *const my_list, const list_iterator_t indx,
+		list_t *const rest)
+{
+	if (rest == my_list){
+		return 1;
+	}
+
+	return list_splice(rest, NULL, my_list, indx, list_end(my_list));
+}
+
+/* ************************************************** */
+/**
+ * @brief Merges two sorted chains, linked through next and ended by NULL.
+ * On ties the node from a goes first, which keeps the sort stable.
+ * @var my_l Pointer to the list, for the counters.
+ * @var a Chain of the elements that were first in the list.
+ * @var b Chain of the elements that came after them.
+ * @var cmp Comparison function.
+ * @return Merged chain, prev fields left unset.
+ */
+static list_node_t *list_merge(list_t *const my_l, list_node_t *a,
+				list_node_t *b, list_cmp_t cmp)
+{
+	list_node_t *head, **tail = &head;
+
+	while (a != NULL && b != NULL){
+		ds_stat_cmp(my_l, 1);
+		if (cmp(a->data, b->data) > 0){
+			*tail = b;
+			b = b->next;
+		} else {
+			*tail = a;
+			a = a->next;
+		}
+		tail = &(*tail)->next;
+	}
+
+	*tail = (a != NULL) ? a : b;
+	return head;
+}
+
+/* ************************************************** */
+/**
+ * Bottom-up merge sort over the next links. Bin i holds a sorted run of
+ * 2^i nodes or nothing; each node taken from the list is carried up the
+ * bins like a binary counter, merging with every full bin on the way, so
+ * runs are merged with runs of the same size and the bins, 32 of them
+ * for a 32 bit size, are all the memory needed. Earlier runs are always
+ * the first operand, and prev links are set in a last pass.
+ */
+void list_sort(list_t *const my_list, list_cmp_t cmp)
+{
+	list_node_t *bins[LIST_SORT_BINS] = {NULL};
+	list_node_t *sent = my_list->sent;
+	list_node_t *n_ptr, *carry, *prev;
+	unsigned int i, used = 0;
+
+	if (my_list->size < 2){
+		return;
+	}
+
+	sent->prev->next = NULL; /* A NULL ended chain, sentinel out */
+	n_ptr = sent->next;
+
+	while (n_ptr != NULL){
+		carry = n_ptr;
+		n_ptr = n_ptr->next;
+		carry->next = NULL;
+
+		for (i = 0; bins[i] != NULL; ++i){
+			carry = list_merge(my_list, bins[i], carry, cmp);
+			bins[i] = NULL;
+		}
+		bins[i] = carry;
+		if (i >= used){
+			used = i + 1;
+		}
+	}
+
+	/* Lower bins hold the later elements */
+	for (carry = NULL, i = 0; i < used; ++i){
+		if (bins[i] != NULL){
+			carry = list_merge(my_list, bins[i], carry, cmp);
+		}
+	}
+
+	/* Back into a ring, with the prev links */
+	prev = sent;
+	for (n_ptr = carry; n_ptr != NULL; n_ptr = n_ptr->next){
+		n_ptr->prev = prev;
+		prev = n_ptr;
+	}
+	sent->next = carry;
+	sent->prev = prev;
+	prev->next = sent;
+}
+
 
 /* ************************************************** */
 
@@ -313,3 +1040,120 @@ list_iterator_t list_iterator_rewind(list_iterator_t *const my_it)
 {
 	return ((list_node_t *) my_it)->prev;
 }
+
+/* ************************************************** */
+
+void *list_iterator_data(const list_iterator_t my_it)
+{
+	return ((list_node_t *) my_it)->data;
+}
+
+/* ************************************************** */
+
+uint8_t list_save(list_t *const my_list, int fd)
+{
+	unsigned char buf[SNAP_CHUNK];
+	struct iovec iov = {buf, 0};
+	list_node_t *n_ptr;
+
+	if (snap_write_header(fd, my_list->el_size, my_list->size)){
+		return 1;
+	}
+
+	for (n_ptr = list_get_sent(my_list)->next; n_ptr != my_list->sent;
+			n_ptr = n_ptr->next){
+		if (iov.iov_len + my_list->el_size > SNAP_CHUNK){
+			if (snap_writev(fd, &iov, 1)){
+				return 1;
+			}
+			iov.iov_base = buf;
+			iov.iov_len = 0;
+		}
+		if (my_list->el_size > SNAP_CHUNK){
+			/* Too big to pack, goes out on its own */
+			iov.iov_base = n_ptr->data;
+			iov.iov_len = my_list->el_size;
+		} else {
+			memcpy(buf + iov.iov_len, n_ptr->data, my_list->el_size);
+			iov.iov_len += my_list->el_size;
+		}
+	}
+
+	return snap_writev(fd, &iov, 1);
+}
+
+/* ************************************************** */
+/**
+ * The slab has a slot for each element plus the sentinel. The packed
+ * elements are read into its end, and then the nodes are carved front to
+ * back, each element sliding down into its node. A node is at least 2
+ * pointers bigger than its element, so a node and its element never reach
+ * the packed elements still to be moved. On failure the private pool goes
+ * away with the nodes, without walking them. Once loaded, the pool goes
+ * back to default sized slabs, or the first push would allocate another
+ * slab as big as the whole snapshot.
+ */
+uint8_t list_load(list_t *const my_list, int fd)
+{
+	snap_header_t hdr;
+	struct iovec iov;
+	list_node_t *n_ptr, *sent;
+	unsigned char *src;
+	uint64_t i;
+	size_t node_size;
+
+	if (snap_read_header(fd, &hdr) || hdr.count >= UINT32_MAX){
+		return 1;
+	}
+
+	/* Slab of count + 1 nodes, plus its chain pointer, must fit a size_t */
+	node_size = LIST_NODE_BYTES(hdr.el_size);
+	if (node_size < hdr.el_size || hdr.count + 2 > SIZE_MAX / node_size){
+		return 1;
+	}
+
+	if (list_init_pooled(my_list, hdr.el_size, hdr.count + 1)){
+		return 1;
+	}
+	sent = list_get_sent(my_list);
+
+	iov.iov_len = hdr.el_size * hdr.count;
+	iov.iov_base = my_list->pool->bump_end - iov.iov_len;
+	if (snap_readv(fd, &iov, 1)){
+		list_destroy(my_list);
+		return 1;
+	}
+
+	for (i = 0, src = iov.iov_base; i < hdr.count; ++i, src += hdr.el_size){
+		n_ptr = list_pool_get(my_list->pool);
+		n_ptr->next = sent;
+		n_ptr->prev = sent->prev;
+		sent->prev->next = n_ptr;
+		sent->prev = n_ptr;
+		memmove(n_ptr->data, src, hdr.el_size);
+	}
+
+	my_list->size = hdr.count;
+	my_list->pool->slab_nodes = LIST_POOL_SLAB_NODES;
+	ds_stat_push(my_list, hdr.count, hdr.count);
+
+	return 0;
+}
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void list_stats_dump(list_t *const my_list, FILE *f)
+{
+	ds_stats_dump(&my_list->stats, "list", my_list->size, f);
+}
+
+/* ************************************************** */
+
+void list_set_resize_hook(list_t *const my_list, ds_resize_hook_t hook)
+{
+	my_list->stats.on_resize = hook;
+}
+
+#endif
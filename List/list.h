@@ -10,6 +10,48 @@
 
 #include <stdlib.h> // For size_t
 #include <stdint.h> // For int types
+#include <stddef.h> // For max_align_t
+#include "stats.h" // For the DS_STATS counters
+
+/*
+ * @brief Bytes taken by a node holding an element of el_size bytes, links
+ * included. Nodes are aligned as malloc would.
+ */
+#define LIST_NODE_BYTES(el_size)								\
+	((2 * sizeof(void *) + (el_size) + _Alignof(max_align_t) - 1) &	\
+	 ~(size_t)(_Alignof(max_align_t) - 1))
+
+/*
+ * @brief Slab allocator for list nodes. Node slots are carved out of big
+ * slabs and recycled through an intrusive free list, so lists drawing
+ * from a pool don't call malloc or free per element. One pool can be
+ * shared by many lists with the same element size.
+ * @var slabs Chain of allocated slabs.
+ * @var free_list Chain of released node slots, linked through the slot.
+ * @var bump Next never used slot in the newest slab.
+ * @var bump_end End of the newest slab.
+ * @var el_size Element size of the lists served.
+ * @var node_size Bytes per node slot, header included.
+ * @var slab_nodes Number of node slots per slab.
+ */
+typedef struct list_pool{
+	void *slabs;			/* Slab chain, released at destroy */
+	void *free_list;		/* Recycled node slots */
+	unsigned char *bump;	/* Next fresh slot */
+	unsigned char *bump_end;/* End of the newest slab */
+	size_t el_size;			/* Element size. Should be constant */
+	size_t node_size;		/* Slot size */
+	uint32_t slab_nodes;	/* Slots per slab */
+} list_pool_t;
+
+/*
+ * @brief Bytes of caller storage needed by list_init_static to hold n
+ * elements of el_size bytes: pool header, sentinel, nodes and slack to
+ * align the buffer.
+ */
+#define LIST_STATIC_BYTES(el_size, n)								\
+	(sizeof(list_pool_t) + _Alignof(max_align_t) * 2 +				\
+	 ((size_t)(n) + 1) * LIST_NODE_BYTES(el_size))
 
 /*
  * @brief A generic double linked list struct using nodes as containers.
@@ -19,11 +61,20 @@
  * @var head Pointer to the head node of the list.
  * @var el_size Size of each element in the list. Should be constant.
  * @var size Current size of the list.
+ * @var pool Node allocator. NULL when nodes come from malloc.
+ * @var own_pool Set when the pool was created by and for this list.
+ * @var index Hash index over the elements. NULL when not enabled.
+ * @var stats Counters, only in DS_STATS builds. Nodes are allocated one
+ * at a time, so resizes and capacity are those of the hash index.
  */
 typedef struct list{
 	void *sent;			/* Pointer to sentinel */	
 	size_t el_size;		/* Element size. Should be constant */
 	uint32_t size;		/* Number of elements in the list */	
+	uint8_t own_pool;	/* Pool is private, destroyed with the list */
+	list_pool_t *pool;	/* Node allocator, NULL for malloc */
+	struct list_index *index; /* Key index, NULL if disabled */
+	DS_STATS_FIELD
 } list_t; 
 
 /*
@@ -32,15 +83,102 @@ typedef struct list{
  */
 typedef void * list_iterator_t;
 
+/*
+ * @brief Compares two elements, or an element and a key.
+ * @return 0 if they match, other value if not, like memcmp.
+ */
+typedef int (*list_cmp_t)(const void *a, const void *b);
+
+/*
+ * @brief Hashes an element, or a key. Elements matching under the index
+ * comparator must get the same hash.
+ * @return Hash value.
+ */
+typedef size_t (*list_hash_t)(const void *item);
+
 /*
  * @brief Initialize a new list.
  * @param [in] my_l Pointer to the list to be initialized.
  * @param [in] size Size in bytes of a single element.
+ * @return Status of the operation.
+ * @retval 0 List ready.
+ * @retval 1 No memory for the sentinel. The list can only be destroyed.
  * @code
  * 		list_init(&l, sizeof(int));
  * @endcode 
  */
-void list_init(list_t *const my_l, size_t size);
+uint8_t list_init(list_t *const my_l, size_t size);
+
+/*
+ * @brief Initialize a new list with a private node pool. Nodes are taken
+ * from slabs of slab_nodes slots and list_destroy releases them in
+ * O(slabs) instead of walking the list.
+ * @param [in] my_l Pointer to the list to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] slab_nodes Nodes per slab. 0 for the default.
+ * @return Status of the operation.
+ * @retval 0 List ready.
+ * @retval 1 No memory for the pool or its first slab. The list can only
+ * be destroyed.
+ */
+uint8_t list_init_pooled(list_t *const my_l, size_t size,
+		uint32_t slab_nodes);
+
+/*
+ * @brief Initialize a new list drawing nodes from a shared pool. The
+ * element size is taken from the pool. On list_destroy the nodes go back
+ * to the pool free list in O(1); the pool must outlive the list.
+ * @param [in] my_l Pointer to the list to be initialized.
+ * @param [in] pool Pointer to an initialized pool.
+ * @return Status of the operation.
+ * @retval 0 List ready.
+ * @retval 1 No node left in the pool for the sentinel. The list can only
+ * be destroyed.
+ * @code
+ * 		list_pool_init(&p, sizeof(int), 0);
+ * 		list_init_shared(&l1, &p);
+ * 		list_init_shared(&l2, &p);
+ * @endcode 
+ */
+uint8_t list_init_shared(list_t *const my_l, list_pool_t *const pool);
+
+/*
+ * @brief Initialize a new list whose pool and nodes live in a buffer
+ * given by the caller. The list never touches the heap: pushes and
+ * inserts fail once the buffer is used up, and deleted nodes are
+ * recycled. Push, pop, insert and delete are O(1) with a single memcpy of
+ * el_size bytes, and destroy is O(1).
+ * @param [in] my_l Pointer to the list to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] buf Node storage.
+ * @param [in] buf_size Bytes in buf, see LIST_STATIC_BYTES.
+ * @return Status of the operation.
+ * @retval 0 List ready.
+ * @retval 1 Buffer too small for the sentinel. The list can only be
+ * destroyed.
+ * @code
+ * 		static unsigned char buf[LIST_STATIC_BYTES(sizeof(int), 64)];
+ * 		list_init_static(&l, sizeof(int), buf, sizeof(buf));
+ * @endcode 
+ */
+uint8_t list_init_static(list_t *const my_l, size_t size, void *buf,
+		size_t buf_size);
+
+/*
+ * @brief Initialize a node pool to be shared among lists.
+ * @param [in] pool Pointer to the pool to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] slab_nodes Nodes per slab. 0 for the default.
+ */
+void list_pool_init(list_pool_t *const pool, size_t size,
+		uint32_t slab_nodes);
+
+/*
+ * @brief Free every slab of the pool. All lists using it must have been
+ * destroyed before.
+ * @param [in] pool Pointer to the pool to be freed up.
+ */
+void list_pool_destroy(list_pool_t *const pool);
  
 /*
  * @brief Destroy the list and free its resources.
@@ -52,8 +190,11 @@ void list_destroy(list_t *const my_list);
  * @brief Adds a new element to the end of list.
  * @param [in] my_list Pointer to the list where will add the item.
  * @param [in] item Pointer to the item to be attached.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 No node available, nothing pushed.
  */
-void list_push_back(list_t *const my_list, void *item);
+uint8_t list_push_back(list_t *const my_list, void *item);
 
 /*
  * @brief Removes an element from the end of list.
@@ -68,8 +209,11 @@ uint32_t list_pop_back(list_t *const my_list, void *item);
  * @brief Attaches a new element to the head of the list.
  * @param [in] my_list Pointer to the list to be modified.
  * @param [in] item Pointer to the item to be stored.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 No node available, nothing pushed.
  */
-void list_push_front(list_t *const my_list, void *item);
+uint8_t list_push_front(list_t *const my_list, void *item);
 
 /*
  * @brief Returns the top element of the list and deletes it.
@@ -147,6 +291,14 @@ list_iterator_t list_iterator_advance(list_iterator_t *const my_it);
  */
 list_iterator_t list_iterator_rewind(list_iterator_t *const my_it);
 
+/*
+ * @brief Gets the element an iterator points to, in place. The pointer
+ * stays valid until that node is deleted.
+ * @param [in] my_it Iterator pointing to a node, not the sentinel.
+ * @return Pointer to the element.
+ */
+void *list_iterator_data(const list_iterator_t my_it);
+
 /*
  * @brief Finds an item in the list, and returns a pointer to the value.
  * @param [in] my_list Pointer to the list to search in.
@@ -157,13 +309,63 @@ list_iterator_t list_iterator_rewind(list_iterator_t *const my_it);
  */
 list_iterator_t list_search(list_t *const my_list, void *const s_itm);
 
+/*
+ * @brief Finds the first item matching a key, compared with a user
+ * function. Unlike list_search it can skip padding or look at some
+ * fields only.
+ * @param [in] my_list Pointer to the list to search in.
+ * @param [in] key Pointer to the key, passed as second argument to cmp.
+ * @param [in] cmp Comparison function, called with each element first.
+ * @return Iterator to found item.
+ * @retval Other Found item.
+ * @retval NULL Not found item.
+ */
+list_iterator_t list_search_by(list_t *const my_list, const void *key,
+		list_cmp_t cmp);
+
+/*
+ * @brief Enables a hash index over the list, built from the current
+ * elements and kept up to date by every push, pop, insert and delete, so
+ * list_lookup runs in O(1) expected. Elements must not be changed in
+ * place in ways that change their hash while indexed.
+ * @param [in] my_list Pointer to the list.
+ * @param [in] hash Hash function of elements and keys.
+ * @param [in] cmp Comparison function, element first and key second.
+ * @return Status of the operation.
+ * @retval 0 Index enabled.
+ * @retval 1 Could not allocate the index, list unchanged.
+ */
+uint8_t list_index_init(list_t *const my_list, list_hash_t hash,
+		list_cmp_t cmp);
+
+/*
+ * @brief Disables the hash index and frees it. list_destroy does it too.
+ * @param [in] my_list Pointer to the list.
+ */
+void list_index_destroy(list_t *const my_list);
+
+/*
+ * @brief Finds an item matching a key through the hash index. With
+ * duplicated keys any of the matching items may be returned. Without an
+ * index it falls back to list_search.
+ * @param [in] my_list Pointer to the list to search in.
+ * @param [in] key Pointer to the key.
+ * @return Iterator to found item.
+ * @retval Other Found item.
+ * @retval NULL Not found item.
+ */
+list_iterator_t list_lookup(list_t *const my_list, const void *key);
+
 /*
  * @brief Insert an item in the list, in the position given.
  * @param [in] my_list Pointer to the list to insert in.
  * @param [in] indx Iterator pointing to where the item will be stored.
  * @param [in] f_itm Pointer to the item to insert.
+ * @return Status of the operation.
+ * @retval 0 Item inserted.
+ * @retval 1 No node available, nothing inserted.
  */
-void list_insert(list_t *const my_list, 
+uint8_t list_insert(list_t *const my_list, 
 		const list_iterator_t indx,	void *const item);
 
 /*
@@ -173,4 +375,111 @@ void list_insert(list_t *const my_list,
  */
 void list_delete(list_t *const my_list, const list_iterator_t indx);
 
+/*
+ * @brief Moves the elements from first to last, both included, out of
+ * src and into dst just before pos. Nodes are relinked where they are,
+ * with no allocation or copy, so iterators and element pointers stay
+ * valid and now belong to dst. Both lists must take nodes from the same
+ * place: malloc, or one shared pool. dst and src can be the same list,
+ * as long as pos is not in the range.
+ * @param [in] dst Pointer to the list to move the elements to.
+ * @param [in] pos Iterator of dst to insert before. NULL for the back.
+ * @param [in] src Pointer to the list to move the elements from.
+ * @param [in] first Iterator to the first element to move.
+ * @param [in] last Iterator to the last element to move, not before first.
+ * @return Status of the operation.
+ * @retval 0 Elements moved, or nothing to move.
+ * @retval 1 Lists with different allocators or element sizes, or no
+ * memory to grow the dst index. Nothing moved.
+ * @code
+ * 		list_splice(&dst, NULL, &src, list_begin(&src), it);
+ * @endcode
+ */
+uint8_t list_splice(list_t *const dst, const list_iterator_t pos,
+		list_t *const src, const list_iterator_t first,
+		const list_iterator_t last);
+
+/*
+ * @brief Moves every element of src to the back of dst, leaving src
+ * empty. O(1) if neither list has an index. Same conditions as
+ * list_splice.
+ * @param [in] dst Pointer to the list to append to.
+ * @param [in] src Pointer to the list to empty.
+ * @return Status of the operation.
+ * @retval 0 Elements moved.
+ * @retval 1 Lists can't share nodes, nothing moved.
+ */
+uint8_t list_concat(list_t *const dst, list_t *const src);
+
+/*
+ * @brief Splits a list in two: the elements from indx to the back are
+ * moved to the back of rest, usually a newly initialized list on the
+ * same allocator. Takes as many steps as the shorter of both halves, to
+ * count them. Same conditions as list_splice.
+ * @param [in] my_list Pointer to the list to split.
+ * @param [in] indx Iterator to the first element to move.
+ * @param [in] rest Pointer to the list getting the elements.
+ * @return Status of the operation.
+ * @retval 0 Elements moved.
+ * @retval 1 Lists can't share nodes, or rest is my_list. Nothing moved.
+ */
+uint8_t list_split_at(list_t *const my_list, const list_iterator_t indx,
+		list_t *const rest);
+
+/*
+ * @brief Sorts the list in place with a stable merge sort: equal elements
+ * keep their order. O(n log n) comparisons, and the nodes are relinked,
+ * not copied or allocated, so iterators follow their elements.
+ * @param [in] my_list Pointer to the list to sort.
+ * @param [in] cmp Comparison function returning less than, equal to or
+ * greater than 0 when the first element goes before, ties or goes after
+ * the second, like memcmp.
+ */
+void list_sort(list_t *const my_list, list_cmp_t cmp);
+
+/*
+ * @brief Writes the elements to a file, front to back, after a header
+ * with their size and number (see Common/snapshot.h). Elements are
+ * packed in SNAP_CHUNK byte writes.
+ * @param [in] my_list Pointer to the list.
+ * @param [in] fd File descriptor to write to, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 List saved.
+ * @retval 1 Write error.
+ */
+uint8_t list_save(list_t *const my_list, int fd);
+
+/*
+ * @brief Initialize a new list from a snapshot, like the ones written by
+ * list_save, stack_save and queue_save. The list gets a private pool
+ * with a single slab holding every node, and the elements are read in
+ * one go into that slab, so there's one allocation and no extra copy
+ * buffer whatever the size. The hash index, if wanted, has to be set up
+ * again with list_index_init.
+ * @param [in] my_list Pointer to the list to be initialized.
+ * @param [in] fd File descriptor to read from, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 List loaded.
+ * @retval 1 Read error, bad snapshot or out of memory. The list is not
+ * initialized.
+ */
+uint8_t list_load(list_t *const my_list, int fd);
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the list counters to a stream, as one JSON line.
+ * @param [in] my_list Pointer to the list.
+ * @param [in] f Stream to write to.
+ */
+void list_stats_dump(list_t *const my_list, FILE *f);
+
+/*
+ * @brief Sets a function to be called every time the hash index changes
+ * its number of slots.
+ * @param [in] my_list Pointer to the list.
+ * @param [in] hook Function to call, NULL for none.
+ */
+void list_set_resize_hook(list_t *const my_list, ds_resize_hook_t hook);
+#endif
+
 #endif /* LIST_H_ */
@@ -1,18 +1,37 @@
 
 #include "list.h"
+#include "ilist.h"
 #include <stdio.h>
 
 #define DATA_TYPE char
 
+typedef struct letter{
+	char c;
+	list_link_t link;
+} letter_t;
+
+static int char_cmp(const void *a, const void *b){
+
+	return *(const char *) a - *(const char *) b;
+}
+
+static int letter_cmp(const list_link_t *lk, const void *key){
+
+	return list_container_of(lk, letter_t, link)->c != *(const char *) key;
+}
+
 int main (int argc, char *argv[]){
 
 	unsigned i;
-	list_t s;
+	list_t s, t;
 	list_iterator_t it;
 	DATA_TYPE *a = "Hi_my_friend" ;
 	DATA_TYPE *c = "Other" ;
 	DATA_TYPE b;
 	DATA_TYPE k = 'O';
+	ilist_t il;
+	letter_t letters[5];
+	list_link_t *lk;
 
 	list_init(&s, sizeof(DATA_TYPE));
 
@@ -32,13 +51,37 @@ int main (int argc, char *argv[]){
 	// Delete test
 	list_delete(&s, it); 
 
+	// Split, sort and concat test, nodes are relinked
+	list_init(&t, sizeof(DATA_TYPE));
+	list_split_at(&s, list_search(&s, &a[3]), &t);
+	list_sort(&s, char_cmp);
+	list_concat(&s, &t);
+	list_destroy(&t);
+
 
 	while (!list_empty(&s)){
 		list_pop_front(&s, &b);
 		printf("%c, %u\n", b, list_size(&s));
 	}
 
+#ifdef DS_STATS
+	list_stats_dump(&s, stdout);
+#endif
 	list_destroy(&s);
+
+	// Intrusive list test, the letters are linked where they are
+	ilist_init(&il);
+	for (i = 0; i < 5; ++i){
+		letters[i].c = c[i];
+		ilist_push_back(&il, &letters[i].link);
+	}
+
+	ilist_move_front(&il, ilist_search_by(&il, "h", letter_cmp));
+
+	while ((lk = ilist_pop_front(&il)) != NULL){
+		printf("%c, %u\n", list_container_of(lk, letter_t, link)->c,
+				ilist_size(&il));
+	}
 	
 	return 0;
 }
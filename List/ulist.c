@@ -0,0 +1,474 @@
+#include <stdlib.h> /* For malloc and free */
+#include <stddef.h> /* For max_align_t */
+#include <string.h> /* For memcpy and memmove */
+#include "ulist.h"
+#include "find.h" /* For elm_find */
+
+#define ULIST_NODE_BYTES 256 /* Default node size, 4 cache lines */
+#define ULIST_MIN_CAP 4 /* Fewest elements per node by default */
+
+/*
+ * @brief Internal node struct. Elements are kept packed at the start of
+ * data, in list order. Only the sentinel has a count of 0, an emptied
+ * node is freed right away.
+ * @var next Pointer to the next node in the list.
+ * @var prev Pointer to the previous node.
+ * @var count Number of elements in the node.
+ * @var data Stored values, node_cap * el_size bytes. Aligned as malloc
+ * would, so pointers to elements can be used as the element type.
+ */
+typedef struct ulist_node{
+	struct ulist_node *next;
+	struct ulist_node *prev;
+	uint32_t count;
+	_Alignas(max_align_t) unsigned char data[];
+} ulist_node_t;
+
+
+/* ************************************************** */
+/**
+ * @brief Macro to easily get the sentinel pointer dereferenced.
+ * @param l List that we want to dereference.
+ */
+#define ulist_get_sent(l) ((ulist_node_t *) (l)->sent)
+
+/**
+ * @brief Macro to get the address of an element in a node.
+ * @param l List the node belongs to.
+ * @param n Node holding the element.
+ * @param i Index of the element in the node.
+ */
+#define ulist_slot(l, n, i) ((n)->data + (l)->el_size * (i))
+
+/* ************************************************** */
+/**
+ * @brief Allocates an empty node and links it after prev.
+ * @param my_l List the node will belong to.
+ * @param prev Node to link it after.
+ * @return The new node, NULL if malloc failed.
+ */
+static ulist_node_t *ulist_node_create(ulist_t *const my_l,
+		ulist_node_t *prev)
+{
+	ulist_node_t *n = malloc(sizeof(ulist_node_t) +
+			my_l->el_size * my_l->node_cap);
+
+	if (n == NULL){
+		return NULL;
+	}
+
+	n->count = 0;
+	n->prev = prev;
+	n->next = prev->next;
+	prev->next->prev = n;
+	prev->next = n;
+	ds_stat_resize(my_l, my_l->stats.capacity + my_l->node_cap, 0);
+
+	return n;
+}
+
+/* ************************************************** */
+/**
+ * @brief Unlinks a node and frees it.
+ * @param my_l List the node belongs to.
+ * @param n Node to free.
+ */
+static void ulist_node_destroy(ulist_t *const my_l, ulist_node_t *n)
+{
+	n->prev->next = n->next;
+	n->next->prev = n->prev;
+	free(n);
+	ds_stat_resize(my_l, my_l->stats.capacity - my_l->node_cap, 0);
+}
+
+/* ************************************************** */
+/**
+ * @brief Stores an item at position idx of a node, moving up the ones
+ * after it. A full node is split first, half of its elements going to a
+ * new node after it.
+ * @param my_l List the node belongs to.
+ * @param n Node to insert in.
+ * @param idx Position in the node, up to its count.
+ * @param item Item to copy in.
+ * @return 0 if inserted, 1 if a node could not be allocated.
+ */
+static uint8_t ulist_put(ulist_t *const my_l, ulist_node_t *n,
+		uint32_t idx, const void *item)
+{
+	ulist_node_t *half;
+	uint32_t moved;
+
+	if (n->count == my_l->node_cap){
+		half = ulist_node_create(my_l, n);
+		if (half == NULL){
+			return 1;
+		}
+
+		moved = n->count / 2;
+		n->count -= moved;
+		memcpy(half->data, ulist_slot(my_l, n, n->count),
+				my_l->el_size * moved);
+		half->count = moved;
+		ds_stat_copy(my_l, my_l->el_size * moved);
+
+		if (idx > n->count){
+			idx -= n->count;
+			n = half;
+		}
+	}
+
+	memmove(ulist_slot(my_l, n, idx + 1), ulist_slot(my_l, n, idx),
+			my_l->el_size * (n->count - idx));
+	memcpy(ulist_slot(my_l, n, idx), item, my_l->el_size);
+	++n->count;
+	++my_l->size;
+	ds_stat_push(my_l, 1, my_l->size);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * @brief Removes the element at position idx of a node. The node is
+ * freed when emptied, or takes in the next one when it's under half full
+ * and both fit in a single node.
+ * @param my_l List the node belongs to.
+ * @param n Node to remove from.
+ * @param idx Position in the node.
+ * @param item Where to copy the element. Could be NULL.
+ */
+static void ulist_take(ulist_t *const my_l, ulist_node_t *n, uint32_t idx,
+		void *item)
+{
+	ulist_node_t *next = n->next;
+
+	if (item != NULL){
+		memcpy(item, ulist_slot(my_l, n, idx), my_l->el_size);
+	}
+
+	--n->count;
+	--my_l->size;
+	ds_stat_pop(my_l, 1);
+	memmove(ulist_slot(my_l, n, idx), ulist_slot(my_l, n, idx + 1),
+			my_l->el_size * (n->count - idx));
+
+	if (n->count == 0){
+		ulist_node_destroy(my_l, n);
+	} else if (n->count < my_l->node_cap / 2 && next != my_l->sent &&
+			n->count + next->count <= my_l->node_cap){
+		memcpy(ulist_slot(my_l, n, n->count), next->data,
+				my_l->el_size * next->count);
+		n->count += next->count;
+		ds_stat_copy(my_l, my_l->el_size * next->count);
+		ulist_node_destroy(my_l, next);
+	}
+}
+
+/* ************************************************** */
+
+uint8_t ulist_init(ulist_t *const my_l, size_t size)
+{
+	return ulist_init_chunked(my_l, size, 0);
+}
+
+/* ************************************************** */
+
+uint8_t ulist_init_chunked(ulist_t *const my_l, size_t size,
+		uint32_t node_cap)
+{
+	ulist_node_t *sent = NULL;
+
+	if (size != 0){
+		sent = malloc(sizeof(ulist_node_t));
+	}
+
+	my_l->sent = sent;
+	if (sent == NULL){
+		return 1;
+	}
+
+	if (node_cap == 0){
+		node_cap = (ULIST_NODE_BYTES - sizeof(ulist_node_t)) / size;
+		if (node_cap < ULIST_MIN_CAP){
+			node_cap = ULIST_MIN_CAP;
+		}
+	} else if (node_cap < 2){
+		node_cap = 2; /* A split must leave both halves non empty */
+	}
+
+	sent->next = sent;
+	sent->prev = sent;
+	sent->count = 0;
+
+	my_l->el_size = size;
+	my_l->size = 0;
+	my_l->node_cap = node_cap;
+	ds_stat_init(my_l, 0);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void ulist_destroy(ulist_t *const my_l)
+{
+	ulist_node_t *n;
+	ulist_node_t *next;
+
+	if (my_l->sent == NULL){
+		return; /* Failed init */
+	}
+
+	n = ulist_get_sent(my_l)->next;
+	while (n != my_l->sent){
+		next = n->next;
+		free(n);
+		n = next;
+	}
+
+	free(my_l->sent);
+}
+
+/* ************************************************** */
+/**
+ * A full last node gets a fresh one after it instead of a split, so lists
+ * built by pushes alone keep their nodes full.
+ */
+uint8_t ulist_push_back(ulist_t *const my_l, const void *item)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->prev;
+
+	if (n->count == 0 || n->count == my_l->node_cap){
+		n = ulist_node_create(my_l, n);
+		if (n == NULL){
+			return 1;
+		}
+	}
+
+	return ulist_put(my_l, n, n->count, item);
+}
+
+/* ************************************************** */
+
+uint8_t ulist_push_front(ulist_t *const my_l, const void *item)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->next;
+
+	if (n->count == 0 || n->count == my_l->node_cap){
+		n = ulist_node_create(my_l, my_l->sent);
+		if (n == NULL){
+			return 1;
+		}
+	}
+
+	return ulist_put(my_l, n, 0, item);
+}
+
+/* ************************************************** */
+
+uint32_t ulist_pop_back(ulist_t *const my_l, void *item)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->prev;
+
+	if (ulist_empty(my_l)){
+		return 0;
+	}
+
+	ulist_take(my_l, n, n->count - 1, item);
+	return my_l->size;
+}
+
+/* ************************************************** */
+
+uint32_t ulist_pop_front(ulist_t *const my_l, void *item)
+{
+	if (ulist_empty(my_l)){
+		return 0;
+	}
+
+	ulist_take(my_l, ulist_get_sent(my_l)->next, 0, item);
+	return my_l->size;
+}
+
+/* ************************************************** */
+
+uint32_t ulist_front(ulist_t *const my_l, void *item)
+{
+	if (!ulist_empty(my_l)){
+		memcpy(item, ulist_get_sent(my_l)->next->data, my_l->el_size);
+	}
+
+	return my_l->size;
+}
+
+/* ************************************************** */
+
+uint32_t ulist_back(ulist_t *const my_l, void *item)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->prev;
+
+	if (!ulist_empty(my_l)){
+		memcpy(item, ulist_slot(my_l, n, n->count - 1), my_l->el_size);
+	}
+
+	return my_l->size;
+}
+
+/* ************************************************** */
+
+ulist_iterator_t ulist_begin(ulist_t *const my_l)
+{
+	ulist_iterator_t it = {ulist_get_sent(my_l)->next, 0};
+
+	if (it.node == my_l->sent){
+		it.node = NULL;
+	}
+
+	return it;
+}
+
+/* ************************************************** */
+
+ulist_iterator_t ulist_end(ulist_t *const my_l)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->prev;
+	ulist_iterator_t it = {n, n->count - 1};
+
+	if (n == my_l->sent){
+		it.node = NULL;
+		it.idx = 0;
+	}
+
+	return it;
+}
+
+/* ************************************************** */
+/**
+ * The sentinel is the only node with no elements, which is how the ends
+ * are found without the list at hand.
+ */
+ulist_iterator_t ulist_iterator_advance(ulist_iterator_t *const my_it)
+{
+	ulist_node_t *n = my_it->node;
+
+	if (n != NULL && ++my_it->idx == n->count){
+		n = n->next;
+		my_it->node = (n->count == 0) ? NULL : n;
+		my_it->idx = 0;
+	}
+
+	return *my_it;
+}
+
+/* ************************************************** */
+
+ulist_iterator_t ulist_iterator_rewind(ulist_iterator_t *const my_it)
+{
+	ulist_node_t *n = my_it->node;
+
+	if (n == NULL){
+		return *my_it;
+	}
+
+	if (my_it->idx > 0){
+		--my_it->idx;
+	} else {
+		n = n->prev;
+		my_it->node = (n->count == 0) ? NULL : n;
+		my_it->idx = (n->count == 0) ? 0 : n->count - 1;
+	}
+
+	return *my_it;
+}
+
+/* ************************************************** */
+
+void *ulist_iterator_data(ulist_t *const my_l, const ulist_iterator_t my_it)
+{
+	return ulist_slot(my_l, (ulist_node_t *) my_it.node, my_it.idx);
+}
+
+/* ************************************************** */
+
+ulist_iterator_t ulist_search(ulist_t *const my_l, const void *s_itm)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->next;
+	ulist_iterator_t it = {NULL, 0};
+	size_t i;
+
+	for (; n != my_l->sent; n = n->next){
+		i = elm_find(n->data, n->count, my_l->el_size, s_itm);
+		ds_stat_cmp(my_l, (i < n->count) ? i + 1 : i);
+		if (i < n->count){
+			it.node = n;
+			it.idx = i;
+			break;
+		}
+	}
+
+	return it;
+}
+
+/* ************************************************** */
+
+ulist_iterator_t ulist_search_by(ulist_t *const my_l, const void *key,
+		ulist_cmp_t cmp)
+{
+	ulist_node_t *n = ulist_get_sent(my_l)->next;
+	ulist_iterator_t it = {NULL, 0};
+	uint32_t i;
+
+	for (; n != my_l->sent; n = n->next){
+		for (i = 0; i < n->count; ++i){
+			ds_stat_cmp(my_l, 1);
+			if (cmp(ulist_slot(my_l, n, i), key) == 0){
+				it.node = n;
+				it.idx = i;
+				return it;
+			}
+		}
+	}
+
+	return it;
+}
+
+/* ************************************************** */
+
+uint8_t ulist_insert(ulist_t *const my_l, const ulist_iterator_t indx,
+		const void *item)
+{
+	if (indx.node == NULL){
+		return ulist_push_back(my_l, item);
+	}
+
+	return ulist_put(my_l, indx.node, indx.idx, item);
+}
+
+/* ************************************************** */
+
+void ulist_delete(ulist_t *const my_l, const ulist_iterator_t indx)
+{
+	if (indx.node == NULL || ulist_empty(my_l)){
+		return;
+	}
+
+	ulist_take(my_l, indx.node, indx.idx, NULL);
+}
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void ulist_stats_dump(ulist_t *const my_l, FILE *f)
+{
+	ds_stats_dump(&my_l->stats, "ulist", my_l->size, f);
+}
+
+/* ************************************************** */
+
+void ulist_set_resize_hook(ulist_t *const my_l, ds_resize_hook_t hook)
+{
+	my_l->stats.on_resize = hook;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * @file ulist.h
+ * @author Juan Manuel Torres Palma
+ * @brief Generic C unrolled list declaration file
+ */
+
+#ifndef ULIST_H_
+#define ULIST_H_
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For int types
+#include "stats.h" // For the DS_STATS counters
+
+/*
+ * @brief A generic double linked list holding a small array of elements
+ * per node, instead of one. Links and malloc headers are paid once per
+ * node, and a walk touches consecutive elements of the same node, so it
+ * suits many small items better than list_t. Nodes split in two when an
+ * insert finds them full and merge with the next one when a delete
+ * leaves them less than half full, if both fit.
+ * @var sent Pointer to the sentinel node, which holds no elements.
+ * @var el_size Size of each element in the list. Should be constant.
+ * @var size Current size of the list.
+ * @var node_cap Maximum number of elements per node.
+ * @var stats Counters, only in DS_STATS builds. Capacity changes by
+ * node_cap with every node allocated or freed, and the elements moved by
+ * splits and merges count as resize bytes.
+ */
+typedef struct ulist{
+	void *sent;			/* Pointer to sentinel */
+	size_t el_size;		/* Element size. Should be constant */
+	uint32_t size;		/* Number of elements in the list */
+	uint32_t node_cap;	/* Elements per node */
+	DS_STATS_FIELD
+} ulist_t;
+
+/*
+ * @brief Iterator to go over the list and find positions: a node and the
+ * index of the element in it. Past either end the node is NULL.
+ * Unlike list_t iterators, any insert or delete invalidates them, as
+ * elements are moved inside and between nodes.
+ * @var node Node holding the element.
+ * @var idx Index of the element in the node.
+ */
+typedef struct ulist_iterator{
+	void *node;
+	uint32_t idx;
+} ulist_iterator_t;
+
+/*
+ * @brief Compares two elements, or an element and a key.
+ * @return 0 if they match, other value if not, like memcmp.
+ */
+typedef int (*ulist_cmp_t)(const void *a, const void *b);
+
+/*
+ * @brief Initialize a new list, with nodes of about 4 cache lines.
+ * @param [in] my_l Pointer to the list to be initialized.
+ * @param [in] size Size in bytes of a single element, not 0.
+ * @return Status of the operation.
+ * @retval 0 List ready.
+ * @retval 1 Element size of 0, or no memory for the sentinel. The list
+ * can only be destroyed.
+ * @code
+ * 		ulist_init(&l, sizeof(int));
+ * @endcode
+ */
+uint8_t ulist_init(ulist_t *const my_l, size_t size);
+
+/*
+ * @brief Initialize a new list choosing how many elements a node holds.
+ * Bigger nodes waste less memory and walk faster, but inserts and
+ * deletes move up to that many elements.
+ * @param [in] my_l Pointer to the list to be initialized.
+ * @param [in] size Size in bytes of a single element, not 0.
+ * @param [in] node_cap Elements per node, at least 2. 0 for the default.
+ * @return Status of the operation, as ulist_init.
+ */
+uint8_t ulist_init_chunked(ulist_t *const my_l, size_t size,
+		uint32_t node_cap);
+
+/*
+ * @brief Destroy the list and free its resources.
+ * @param my_l Pointer to the list to be freed up.
+ */
+void ulist_destroy(ulist_t *const my_l);
+
+/*
+ * @brief Adds a new element to the end of list.
+ * @param [in] my_l Pointer to the list where will add the item.
+ * @param [in] item Pointer to the item to be attached.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Could not allocate a node, nothing pushed.
+ */
+uint8_t ulist_push_back(ulist_t *const my_l, const void *item);
+
+/*
+ * @brief Attaches a new element to the head of the list.
+ * @param [in] my_l Pointer to the list to be modified.
+ * @param [in] item Pointer to the item to be stored.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Could not allocate a node, nothing pushed.
+ */
+uint8_t ulist_push_front(ulist_t *const my_l, const void *item);
+
+/*
+ * @brief Removes an element from the end of list.
+ * @param [in] my_l Pointer to the list to get an item removed.
+ * @param [out] item Pointer to a variable to store the removed value.
+ * Could be NULL.
+ * @return Number of elements remaining in the list.
+ */
+uint32_t ulist_pop_back(ulist_t *const my_l, void *item);
+
+/*
+ * @brief Returns the first element of the list and deletes it.
+ * @param [in] my_l Pointer to the list to be popped.
+ * @param [out] item Pointer to the item where will store the value.
+ * Could be NULL.
+ * @return Number of elements remaining in my_l.
+ */
+uint32_t ulist_pop_front(ulist_t *const my_l, void *item);
+
+/*
+ * @brief Gets the first element in the list.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @param [out] item Pointer to the item where will store the value.
+ * @return Number of elements in my_l.
+ */
+uint32_t ulist_front(ulist_t *const my_l, void *item);
+
+/*
+ * @brief Gets the last element in the list.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @param [out] item Pointer to the item where will store the value.
+ * @return Number of elements in my_l.
+ */
+uint32_t ulist_back(ulist_t *const my_l, void *item);
+
+/*
+ * @brief Checks if the list is empty.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @return Status of the list.
+ * @retval 1 Empty list.
+ * @retval 0 Not empty list.
+ */
+static inline uint8_t ulist_empty(ulist_t *const my_l)
+{
+	return (my_l->size == 0);
+}
+
+/*
+ * @brief Returns the number of allocated items.
+ * @param [in] my_l Pointer to the list to be checked.
+ * @return Number of items in the list.
+ */
+static inline unsigned int ulist_size(ulist_t *const my_l)
+{
+	return my_l->size;
+}
+
+/*
+ * @brief Returns an iterator to the first element of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return Iterator to first element, node NULL if empty.
+ */
+ulist_iterator_t ulist_begin(ulist_t *const my_l);
+
+/*
+ * @brief Returns an iterator to the last element of the list.
+ * @param [in] my_l Pointer to the list.
+ * @return Iterator to last element, node NULL if empty.
+ */
+ulist_iterator_t ulist_end(ulist_t *const my_l);
+
+/*
+ * @brief Moves an iterator to the next element.
+ * @param [in,out] my_it Iterator pointing to an element.
+ * @return The moved iterator, node NULL past the last element.
+ */
+ulist_iterator_t ulist_iterator_advance(ulist_iterator_t *const my_it);
+
+/*
+ * @brief Moves an iterator to the previous element.
+ * @param [in,out] my_it Iterator pointing to an element.
+ * @return The moved iterator, node NULL before the first element.
+ */
+ulist_iterator_t ulist_iterator_rewind(ulist_iterator_t *const my_it);
+
+/*
+ * @brief Gets the element an iterator points to, in place.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] my_it Iterator pointing to an element.
+ * @return Pointer to the element.
+ */
+void *ulist_iterator_data(ulist_t *const my_l, const ulist_iterator_t my_it);
+
+/*
+ * @brief Finds an item in the list, compared byte by byte. Each node is
+ * scanned as an array, many small elements at a time.
+ * @param [in] my_l Pointer to the list to search in.
+ * @param [in] s_itm Pointer to the searched item.
+ * @return Iterator to found item, node NULL if not found.
+ */
+ulist_iterator_t ulist_search(ulist_t *const my_l, const void *s_itm);
+
+/*
+ * @brief Finds the first item matching a key, compared with a user
+ * function.
+ * @param [in] my_l Pointer to the list to search in.
+ * @param [in] key Pointer to the key, passed as second argument to cmp.
+ * @param [in] cmp Comparison function, called with each element first.
+ * @return Iterator to found item, node NULL if not found.
+ */
+ulist_iterator_t ulist_search_by(ulist_t *const my_l, const void *key,
+		ulist_cmp_t cmp);
+
+/*
+ * @brief Insert an item just before the one an iterator points to. A NULL
+ * node iterator appends it to the end.
+ * @param [in] my_l Pointer to the list to insert in.
+ * @param [in] indx Iterator pointing to where the item will be stored.
+ * @param [in] item Pointer to the item to insert.
+ * @return Status of the operation.
+ * @retval 0 Item inserted.
+ * @retval 1 Could not allocate a node, nothing inserted.
+ */
+uint8_t ulist_insert(ulist_t *const my_l, const ulist_iterator_t indx,
+		const void *item);
+
+/*
+ * @brief Removes the item an iterator points to.
+ * @param [in] my_l Pointer to the list to delete from.
+ * @param [in] indx Iterator to the item. Nothing done if node is NULL.
+ */
+void ulist_delete(ulist_t *const my_l, const ulist_iterator_t indx);
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the list counters to a stream, as one JSON line.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] f Stream to write to.
+ */
+void ulist_stats_dump(ulist_t *const my_l, FILE *f);
+
+/*
+ * @brief Sets a function to be called every time a node is allocated or
+ * freed, with the old and new capacity.
+ * @param [in] my_l Pointer to the list.
+ * @param [in] hook Function to call, NULL for none.
+ */
+void ulist_set_resize_hook(ulist_t *const my_l, ds_resize_hook_t hook);
+#endif
+
+#endif /* ULIST_H_ */
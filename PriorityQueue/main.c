@@ -0,0 +1,38 @@
+#include "pq.h"
+#include <stdio.h>
+
+#define DATA_TYPE char
+
+static int char_cmp(const void *a, const void *b){
+	return *(const DATA_TYPE *) a - *(const DATA_TYPE *) b;
+}
+
+int main (int argc, char *argv[]){
+
+	unsigned i;
+	pq_t s;
+	DATA_TYPE *a = "Hi_my_friend" ;
+	DATA_TYPE *c = "Other" ;
+	DATA_TYPE b;
+
+	pq_init(&s, sizeof(DATA_TYPE), char_cmp);
+
+	pq_heapify(&s, a, 12);
+
+	for (i = 0; i < 5; ++i){
+		pq_push(&s, &(c[i]));
+	}
+
+	//Comes out sorted
+	while (!pq_empty(&s)){
+		pq_pop(&s, &b);
+		printf("%c, %u\n", b, pq_size(&s));
+	}
+
+#ifdef DS_STATS
+	pq_stats_dump(&s, stdout);
+#endif
+	pq_destroy(&s);
+	
+	return 0;
+}
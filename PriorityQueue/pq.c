@@ -0,0 +1,223 @@
+#include "pq.h"
+#include <stdlib.h> //For malloc and free
+#include <string.h>  //For memcpy
+
+#define PQ_ARITY 4 //Children per node
+
+/**
+ * @brief Macro to get the address of a heap position.
+ * @param pq Pointer to the queue structure.
+ * @param indx Position in the heap array.
+ */
+#define pq_calc_address(pq, indx)							\
+	((unsigned char *) (pq)->heap.data + (pq)->heap.el_size * (indx))
+
+/* ************************************************** */
+/**
+ * @brief Moves an element up from a position until its parent goes
+ * first. Parents that go after it are moved down into the hole.
+ * @param my_pq Pointer to the queue.
+ * @param hole Position to start from, its content is overwritten.
+ * @param item Element to place, not inside the heap array.
+ */
+static void pq_sift_up(pq_t *const my_pq, unsigned int hole,
+		const void *item){
+
+	size_t el_size = my_pq->heap.el_size;
+	unsigned int parent;
+
+	while (hole > 0){
+		parent = (hole - 1) / PQ_ARITY;
+		if (my_pq->cmp(item, pq_calc_address(my_pq, parent)) >= 0){
+			break;
+		}
+		memcpy(pq_calc_address(my_pq, hole), pq_calc_address(my_pq, parent),
+				el_size);
+		hole = parent;
+	}
+
+	memcpy(pq_calc_address(my_pq, hole), item, el_size);
+}
+
+/* ************************************************** */
+/**
+ * @brief Moves an element down from a position until no child goes
+ * before it. The first child of the hole is moved up into it each step.
+ * @param my_pq Pointer to the queue.
+ * @param hole Position to start from, its content is overwritten.
+ * @param item Element to place, not inside the heap array.
+ */
+static void pq_sift_down(pq_t *const my_pq, unsigned int hole,
+		const void *item){
+
+	size_t el_size = my_pq->heap.el_size;
+	unsigned int size = stack_size(&my_pq->heap);
+	unsigned int child, best, last;
+
+	for (;;){
+		child = hole * PQ_ARITY + 1;
+		if (child >= size){
+			break;
+		}
+
+		last = (size - child < PQ_ARITY) ? size : child + PQ_ARITY;
+		for (best = child++; child < last; ++child){
+			if (my_pq->cmp(pq_calc_address(my_pq, child),
+					pq_calc_address(my_pq, best)) < 0){
+				best = child;
+			}
+		}
+
+		if (my_pq->cmp(pq_calc_address(my_pq, best), item) >= 0){
+			break;
+		}
+		memcpy(pq_calc_address(my_pq, hole), pq_calc_address(my_pq, best),
+				el_size);
+		hole = best;
+	}
+
+	memcpy(pq_calc_address(my_pq, hole), item, el_size);
+}
+
+/* ************************************************** */
+/**
+ * @brief Orders the whole array, sifting down every parent from the
+ * last one. O(n), as most nodes are near the bottom.
+ * @param my_pq Pointer to the queue.
+ */
+static void pq_build(pq_t *const my_pq){
+
+	unsigned int size = stack_size(&my_pq->heap);
+	unsigned int i;
+
+	if (size < 2){
+		return;
+	}
+
+	for (i = (size - 2) / PQ_ARITY + 1; i-- > 0; ){
+		memcpy(my_pq->tmp, pq_calc_address(my_pq, i), my_pq->heap.el_size);
+		pq_sift_down(my_pq, i, my_pq->tmp);
+	}
+}
+
+/* ************************************************** */
+
+void pq_init(pq_t *const my_pq, size_t size, pq_cmp_t cmp){
+
+	stack_init(&my_pq->heap, size);
+	my_pq->cmp = cmp;
+	my_pq->tmp = malloc(size);
+}
+
+/* ************************************************** */
+
+void pq_destroy(pq_t *const my_pq){
+	stack_destroy(&my_pq->heap);
+	free(my_pq->tmp);
+}
+
+/* ************************************************** */
+
+unsigned char pq_push(pq_t *const my_pq, const void *item){
+
+	if (stack_emplace(&my_pq->heap) == NULL){
+		return 1;
+	}
+
+	pq_sift_up(my_pq, stack_size(&my_pq->heap) - 1, item);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * Sifting up n items costs about n * log(size) compares in the worst
+ * case, and a rebuild about 2 * (size + n), so a run as big as what's
+ * already queued is better placed with a rebuild. Sifted items get their
+ * room reserved first, so the pushes can't fail halfway.
+ */
+unsigned char pq_push_n(pq_t *const my_pq, const void *items,
+		unsigned int n){
+
+	unsigned int old = stack_size(&my_pq->heap);
+	unsigned int i;
+
+	if (n >= old){
+		if (stack_push_n(&my_pq->heap, items, n)){
+			return 1;
+		}
+		pq_build(my_pq);
+		return 0;
+	}
+
+	if (n > ~0u - old || stack_reserve(&my_pq->heap, old + n)){
+		return 1;
+	}
+
+	for (i = 0; i < n; ++i){
+		pq_push(my_pq, (const unsigned char *) items +
+				my_pq->heap.el_size * i);
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char pq_heapify(pq_t *const my_pq, const void *items,
+		unsigned int n){
+
+	stack_pop_n(&my_pq->heap, NULL, stack_size(&my_pq->heap));
+
+	if (stack_push_n(&my_pq->heap, items, n)){
+		return 1;
+	}
+
+	pq_build(my_pq);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * The last element fills the hole left at the top and sinks from there.
+ * It's taken out with stack_pop, so the array shrinks under the stack
+ * policy.
+ */
+unsigned int pq_pop(pq_t *const my_pq, void *item){
+
+	if (pq_empty(my_pq)){
+		return 0;
+	}
+
+	if (item != NULL){
+		memcpy(item, pq_calc_address(my_pq, 0), my_pq->heap.el_size);
+	}
+
+	if (stack_pop(&my_pq->heap, my_pq->tmp) > 0){
+		pq_sift_down(my_pq, 0, my_pq->tmp);
+	}
+
+	return stack_size(&my_pq->heap);
+}
+
+/* ************************************************** */
+
+unsigned int pq_top(pq_t *const my_pq, void *item){
+
+	if (!pq_empty(my_pq)){
+		memcpy(item, pq_calc_address(my_pq, 0), my_pq->heap.el_size);
+	}
+
+	return stack_size(&my_pq->heap);
+}
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void pq_stats_dump(pq_t *const my_pq, FILE *f){
+	ds_stats_dump(&my_pq->heap.stats, "pq", stack_size(&my_pq->heap), f);
+}
+
+#endif
@@ -0,0 +1,139 @@
+
+/**
+ * @file pq.h
+ * @author Juan Manuel Torres Palma
+ * @brief Generic C priority queue declaration file
+ */
+
+#ifndef PQ_H_
+#define PQ_H_
+
+#include <stdlib.h> // For size_t
+#include "stack.h" // For the growable array
+
+/*
+ * @brief Compares two elements.
+ * @return Negative if a goes out before b, 0 if they tie, positive if b
+ * goes out before a.
+ */
+typedef int (*pq_cmp_t)(const void *a, const void *b);
+
+/*
+ * @brief A generic priority queue, a 4-ary heap kept in a stack_t, so it
+ * grows and shrinks with the stack policies. The 4 children of a node
+ * are contiguous, often in the same cache line, and the tree is half as
+ * deep as a binary heap, so sift downs touch fewer lines.
+ * Elements are moved through a hole instead of swapped: the one being
+ * placed is kept aside and every step is a single memcpy.
+ * @var heap Elements in heap order, the top at index 0.
+ * @var cmp Comparison function.
+ * @var tmp Room for one element, the one kept aside.
+ */
+typedef struct pq{
+	stack_t heap;		/* Heap array */
+	pq_cmp_t cmp;		/* Order */
+	void *tmp;			/* Element being placed */
+} pq_t;
+
+/*
+ * @brief Initialize a new priority queue.
+ * @param [in] my_pq Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] cmp Comparison function, the smallest element goes first.
+ * @code
+ * 		pq_init(&pq, sizeof(timer_t), timer_cmp);
+ * @endcode
+ */
+void pq_init(pq_t *const my_pq, size_t size, pq_cmp_t cmp);
+
+/*
+ * @brief Destroy the queue and free its resources.
+ * @param my_pq Pointer to the queue to be freed up.
+ */
+void pq_destroy(pq_t *const my_pq);
+
+/*
+ * @brief Adds a new element. O(log n).
+ * @param [in] my_pq Pointer to the queue where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Could not grow the queue, nothing pushed.
+ */
+unsigned char pq_push(pq_t *const my_pq, const void *item);
+
+/*
+ * @brief Adds n elements. Sifts up each of them, or rebuilds the whole
+ * heap in O(size + n) when that's cheaper.
+ * @param [in] my_pq Pointer to the queue where will add the items.
+ * @param [in] items Array of n items.
+ * @param [in] n Number of items.
+ * @return Status of the operation.
+ * @retval 0 Items pushed.
+ * @retval 1 Could not grow the queue, nothing pushed.
+ */
+unsigned char pq_push_n(pq_t *const my_pq, const void *items,
+		unsigned int n);
+
+/*
+ * @brief Replaces the content of the queue with n elements, ordered in
+ * O(n) bottom up.
+ * @param [in] my_pq Pointer to the queue.
+ * @param [in] items Array of n items.
+ * @param [in] n Number of items.
+ * @return Status of the operation.
+ * @retval 0 Queue rebuilt.
+ * @retval 1 Could not grow the queue, left empty.
+ */
+unsigned char pq_heapify(pq_t *const my_pq, const void *items,
+		unsigned int n);
+
+/*
+ * @brief Removes the first element. O(log n).
+ * @param [in] my_pq Pointer to the queue to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Number of elements remaining in the queue.
+ */
+unsigned int pq_pop(pq_t *const my_pq, void *item);
+
+/*
+ * @brief Gets the first element without removing it.
+ * @param [in] my_pq Pointer to the queue to be checked.
+ * @param [out] item Pointer to store the value.
+ * @return Number of elements in the queue.
+ */
+unsigned int pq_top(pq_t *const my_pq, void *item);
+
+/*
+ * @brief Checks if the queue is empty.
+ * @param [in] my_pq Pointer to the queue to be checked.
+ * @return State of the queue.
+ * @retval 1 Empty queue.
+ * @retval 0 Not empty queue.
+ */
+static inline unsigned char pq_empty(pq_t *const my_pq)
+{
+	return stack_empty(&my_pq->heap);
+}
+
+/*
+ * @brief Returns the number of allocated items.
+ * @param [in] my_pq Pointer to the queue to be checked.
+ * @return Number of items in the queue.
+ */
+static inline unsigned int pq_size(pq_t *const my_pq)
+{
+	return stack_size(&my_pq->heap);
+}
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the counters of the heap array to a stream, as one JSON
+ * line.
+ * @param [in] my_pq Pointer to the priority queue.
+ * @param [in] f Stream to write to.
+ */
+void pq_stats_dump(pq_t *const my_pq, FILE *f);
+#endif
+
+#endif /* PQ_H_ */
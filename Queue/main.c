@@ -15,7 +15,7 @@ int main (int argc, char *argv[]){
 	queue_init(&s, sizeof(DATA_TYPE));
 
 	//Force resize
-	for (i = 0; i < 7; ++i){
+	for (i = 0; i < 12; ++i){
 		queue_push_back(&s, &(a[i]));
 	}
 
@@ -23,8 +23,8 @@ int main (int argc, char *argv[]){
 	queue_pop_front(&s, NULL);
 
 	
-	//Force resize
-	for (i = 0; i < 3; ++i){  //"i myMi" H=0, T=5 
+	//Force wraparound
+	for (i = 0; i < 5; ++i){  //"_my_friendOther" H=2, T=17 
 		queue_push_back(&s, &(c[i]));
 	}
 
@@ -34,6 +34,9 @@ int main (int argc, char *argv[]){
 	}
 
 
+#ifdef DS_STATS
+	queue_stats_dump(&s, stdout);
+#endif
 	queue_destroy(&s);
 	
 	return 0;
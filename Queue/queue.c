@@ -1,51 +1,355 @@
 #include "queue.h"
 #include <stdlib.h> //For malloc and free
 #include <string.h>  //For memcpy
+#include <stdint.h> //For the file header types
+#include <fcntl.h> //For open
+#include <unistd.h> //For close and ftruncate
+#include <sys/stat.h> //For fstat
+#include <sys/mman.h> //For mmap, msync and munmap
+#include "find.h" //For elm_find
+#include "snapshot.h" //For the snapshot format
+
+#define DEFAULT_QUEUE_ELM 8  //Initial size of the data array, power of 2
+#define DEFAULT_QUEUE_GROWTH 200 //Percent, doubles
+#define QUEUE_MAX_CAPACITY ((~0u >> 1) + 1) //Biggest power of 2 that fits
+
+#define QUEUE_STATIC 0x01 //Buffer owned by the caller, never resized
+#define QUEUE_SHRINK 0x02 //Shrink automatically on pop
+/* QUEUE_FILE 0x04, in queue.h: buffer is a mapped file, after its header */
+
+#define QUEUE_FILE_MAGIC 0x51534447 //"GDSQ" read as little endian
+#define QUEUE_FILE_VERSION 1
+#define QUEUE_FILE_HEADER 64 //Bytes before the first slot, a cache line
 
-#define DEFAULT_QUEUE_ELM 5  //Initial size of the data array
+/*
+ * @brief Start of a queue file, followed by the slots.
+ * @var magic QUEUE_FILE_MAGIC, tells a queue file.
+ * @var version Layout version, QUEUE_FILE_VERSION.
+ * @var el_size Size of each element.
+ * @var capacity Number of slots, power of 2.
+ * @var head Counter of the first item.
+ * @var tail Counter where the next item goes.
+ */
+typedef struct queue_file_header{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t el_size;
+	uint32_t capacity;
+	uint32_t head;
+	uint32_t tail;
+} queue_file_header_t;
 
 /**
- * @brief Macro to easily get the address from a queue index.
+ * @brief Macro to easily get the address from a free running counter.
  * @param queue Pointer to the queue structure.
- * @param indx Index that we want to ge the address of.
+ * @param indx Counter that we want to ge the address of.
  */
 #define queue_calc_address(queue,indx)			\
-	 queue->data + (queue->el_size * indx)
+	 queue->data + (queue->el_size * ((indx) & (queue->max_size - 1)))
+
+/**
+ * @brief Macro to get the header of a file backed queue.
+ * @param queue Pointer to the queue structure.
+ */
+#define queue_file_header(queue)							\
+	((queue_file_header_t *) ((unsigned char *) (queue)->data -	\
+			QUEUE_FILE_HEADER))
 		
 
 
 
 static unsigned char queue_resize(queue_t *my_q, unsigned int new_size);
 
+/* ************************************************** */
+/**
+ * @brief Rounds up to a power of 2. Above QUEUE_MAX_CAPACITY there's none
+ * an unsigned int holds, and doubling would wrap to 0 and never end.
+ * @param n Number to round.
+ * @return Smallest power of 2 not below n, QUEUE_MAX_CAPACITY at most.
+ */
+static inline unsigned int queue_pow2(unsigned int n){
+
+	unsigned int p = 1;
+
+	if (n > QUEUE_MAX_CAPACITY){
+		return QUEUE_MAX_CAPACITY;
+	}
+
+	while (p < n){
+		p <<= 1;
+	}
+
+	return p;
+}
+
+/* ************************************************** */
+/**
+ * @brief Computes the capacity after growing until needed elements fit.
+ * Each step grows by the growth factor rounded up to a power of 2, so at
+ * least doubles.
+ * @param my_q Pointer to the queue.
+ * @param needed Number of elements that must fit.
+ * @return New capacity.
+ */
+static unsigned int queue_grown_size(queue_t *const my_q,
+		unsigned int needed){
+
+	unsigned long long new_size = my_q->max_size;
+
+	while (new_size < needed){
+		new_size = new_size * my_q->growth / 100 + 1;
+	}
+
+	return queue_pow2(new_size > QUEUE_MAX_CAPACITY ?
+			QUEUE_MAX_CAPACITY : new_size);
+}
+
+/* ************************************************** */
+/**
+ * @brief Halves the capacity once the queue is a quarter full, if
+ * automatic shrink is on. Not going below min_size.
+ * @param my_q Pointer to the queue.
+ */
+static inline void queue_shrink_check(queue_t *const my_q){
+
+	unsigned int new_size = my_q->max_size / 2;
+
+	if ((my_q->flags & QUEUE_SHRINK) &&
+			queue_size(my_q) <= my_q->max_size / 4 &&
+			new_size >= my_q->min_size && new_size > 0){
+		queue_resize(my_q, new_size);
+	}
+}
+
+/* ************************************************** */
+/**
+ * @brief Copies head and tail to the header of a file backed queue, so
+ * the file always tells the current state.
+ * @param my_q Pointer to the queue.
+ */
+static inline void queue_file_mark(queue_t *const my_q){
+
+	if (my_q->flags & QUEUE_FILE){
+		queue_file_header(my_q)->head = my_q->head;
+		queue_file_header(my_q)->tail = my_q->tail;
+	}
+}
+
 /* ************************************************** */
 
 void queue_init(queue_t *const my_q, size_t size){
+	queue_init_capacity(my_q, size, DEFAULT_QUEUE_ELM); // Eight spots
+}
+
+/* ************************************************** */
+
+void queue_init_capacity(queue_t *const my_q, size_t size,
+		unsigned int capacity){
 
 	my_q->el_size = size; 			 // Data size
-	my_q->max_size = DEFAULT_QUEUE_ELM;// Five spots
-	my_q->size = 0; 				 // Zero elements initially.	
+	my_q->max_size = queue_pow2(capacity);
+	my_q->min_size = my_q->max_size;
+	my_q->growth = DEFAULT_QUEUE_GROWTH;
 
 	my_q->data = malloc((size_t)size * my_q->max_size); //Allocate data
+	if (my_q->data == NULL){
+		my_q->max_size = 0; //No room, the first push tries again
+	}
 	my_q->tail = 0; //First place to add data.
 	my_q->head = 0;
+	my_q->flags = 0;
+	ds_stat_init(my_q, my_q->max_size);
+}
+
+/* ************************************************** */
+
+void queue_init_static(queue_t *const my_q, size_t size, void *buf,
+		unsigned int capacity){
+
+	my_q->el_size = size;
+	my_q->max_size = 1;
+
+	/* Round down to a power of 2 */
+	while (my_q->max_size <= capacity / 2){
+		my_q->max_size <<= 1;
+	}
+
+	/* No slot at all: always full, and the static flag fails the pushes */
+	if (capacity == 0){
+		my_q->max_size = 0;
+	}
+
+	my_q->min_size = my_q->max_size;
+	my_q->growth = DEFAULT_QUEUE_GROWTH;
+	my_q->data = buf;
+	my_q->tail = 0;
+	my_q->head = 0;
+	my_q->flags = QUEUE_STATIC;
+	ds_stat_init(my_q, my_q->max_size);
+}
+
+/* ************************************************** */
+/**
+ * The file is mapped shared, so stores to the slots and header are the
+ * file contents as soon as they're done, for any process opening it
+ * later. An existing file must be a whole queue of the same element
+ * size, or it's left untouched.
+ */
+unsigned char queue_open_file(queue_t *const my_q, const char *path,
+		size_t size, unsigned int capacity){
+
+	queue_file_header_t *hdr;
+	struct stat st;
+	size_t len;
+	void *base;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0){
+		return 1;
+	}
+
+	if (fstat(fd, &st) < 0){
+		close(fd);
+		return 1;
+	}
+
+	if (st.st_size == 0){
+		//New queue, sized on the capacity asked
+		if (capacity == 0 || capacity > QUEUE_MAX_CAPACITY){
+			close(fd);
+			return 1;
+		}
+		capacity = queue_pow2(capacity);
+		len = QUEUE_FILE_HEADER + size * capacity;
+		if (ftruncate(fd, len) < 0){
+			close(fd);
+			return 1;
+		}
+	} else {
+		len = st.st_size;
+	}
+
+	base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd); //The mapping keeps the file open
+	if (base == MAP_FAILED){
+		return 1;
+	}
+
+	hdr = base;
+	if (st.st_size == 0){
+		hdr->magic = QUEUE_FILE_MAGIC;
+		hdr->version = QUEUE_FILE_VERSION;
+		hdr->el_size = size;
+		hdr->capacity = capacity;
+		hdr->head = 0;
+		hdr->tail = 0;
+	} else if (len < QUEUE_FILE_HEADER || hdr->magic != QUEUE_FILE_MAGIC ||
+			hdr->version != QUEUE_FILE_VERSION || hdr->el_size != size ||
+			hdr->capacity == 0 ||
+			(hdr->capacity & (hdr->capacity - 1)) != 0 ||
+			len != QUEUE_FILE_HEADER + size * hdr->capacity ||
+			hdr->tail - hdr->head > hdr->capacity){
+		munmap(base, len);
+		return 1;
+	}
+
+	my_q->data = (unsigned char *) base + QUEUE_FILE_HEADER;
+	my_q->el_size = size;
+	my_q->max_size = hdr->capacity;
+	my_q->min_size = hdr->capacity;
+	my_q->growth = DEFAULT_QUEUE_GROWTH;
+	my_q->head = hdr->head;
+	my_q->tail = hdr->tail;
+	my_q->flags = QUEUE_STATIC | QUEUE_FILE; //Never resized
+	ds_stat_init(my_q, my_q->max_size);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char queue_sync(queue_t *const my_q){
+
+	if (!(my_q->flags & QUEUE_FILE)){
+		return 1;
+	}
+
+	return msync(queue_file_header(my_q), QUEUE_FILE_HEADER +
+			my_q->el_size * my_q->max_size, MS_SYNC) != 0;
 }
 
 /* ************************************************** */
 
 void queue_destroy(queue_t *const my_queue){
-	free(my_queue->data);
+	if (my_queue->flags & QUEUE_FILE){
+		munmap(queue_file_header(my_queue), QUEUE_FILE_HEADER +
+				my_queue->el_size * my_queue->max_size);
+	} else if (!(my_queue->flags & QUEUE_STATIC)){
+		free(my_queue->data);
+	}
+}
+
+/* ************************************************** */
+
+void queue_set_policy(queue_t *const my_q, unsigned short growth,
+		unsigned char auto_shrink){
+
+	my_q->growth = (growth > 100) ? growth : DEFAULT_QUEUE_GROWTH;
+
+	if (auto_shrink){
+		my_q->flags |= QUEUE_SHRINK;
+	} else {
+		my_q->flags &= ~QUEUE_SHRINK;
+	}
+}
+
+/* ************************************************** */
+
+unsigned char queue_reserve(queue_t *const my_q, unsigned int n){
+
+	unsigned int new_size = queue_pow2(n);
+
+	if (n > QUEUE_MAX_CAPACITY){
+		return 1;
+	}
+
+	if (new_size > my_q->max_size && queue_resize(my_q, new_size)){
+		return 1;
+	}
+
+	if (new_size > my_q->min_size){
+		my_q->min_size = new_size;
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char queue_shrink_to_fit(queue_t *const my_q){
+
+	unsigned int new_size = queue_pow2(queue_size(my_q));
+
+	if (new_size == my_q->max_size){
+		return 0;
+	}
+
+	return queue_resize(my_q, new_size);
 }
 
 /* ************************************************** */
 /**
- * We can always push elements into the stack, cause in case it's full
- * it will be resized. 
+ * We can always push elements into the queue, cause in case it's full
+ * it will be resized, unless the buffer belongs to the caller.
  */
-void queue_push_back(queue_t *const my_queue, void *item){
+unsigned char queue_push_back(queue_t *const my_queue, void *item){
  
-	/* If full, double the size */
-	if (queue_full(my_queue)){
-		queue_resize(my_queue, (my_queue->max_size)*2);
+	/* If full, grow by the growth factor */
+	if (queue_full(my_queue) &&
+			queue_resize(my_queue, queue_grown_size(my_queue,
+					queue_size(my_queue) + 1))){
+		return 1;
 	}
 
 	/* The position to append the new item is in tail */
@@ -54,18 +358,29 @@ void queue_push_back(queue_t *const my_queue, void *item){
  	/* Copy data into queue */	
 	memcpy(tail_address, item, my_queue->el_size);
 
-	/* Increase size */
-	++(my_queue->size);
-
-	/* Increase tail index */
+	/* Increase tail counter, masked on use so it can just wrap */
 	++(my_queue->tail);
+	queue_file_mark(my_queue);
+	ds_stat_push(my_queue, 1, queue_size(my_queue));
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void *queue_emplace_back(queue_t *const my_queue){
 
-	/* Check if it's in the last position */
-	if (my_queue->tail == my_queue->max_size){
-		/* Go back to beggining */
-		my_queue->tail = 0;
+	if (queue_full(my_queue) &&
+			queue_resize(my_queue, queue_grown_size(my_queue,
+					queue_size(my_queue) + 1))){
+		return NULL;
 	}
 
+	void *slot = queue_calc_address(my_queue, my_queue->tail++);
+
+	queue_file_mark(my_queue);
+	ds_stat_push(my_queue, 1, queue_size(my_queue));
+	return slot;
 }
 
 /* ************************************************** */
@@ -86,15 +401,86 @@ unsigned int queue_pop_front(queue_t *const my_queue, void *item){
 	}
 
 	++my_queue->head;
+	queue_file_mark(my_queue);
+	ds_stat_pop(my_queue, 1);
 
-	if (my_queue->head == my_queue->max_size){
-		my_queue->head = 0;
-	}
-	
-	return --my_queue->size;
+	queue_shrink_check(my_queue);
+	return queue_size(my_queue);
 	
 }
 
+/* ************************************************** */
+/**
+ * Grows the capacity until n more items fit, so the queue is resized
+ * at most once. The run is split where it crosses the end of the array.
+ */
+unsigned char queue_push_n(queue_t *const my_queue, const void *items,
+		unsigned int n){
+
+	unsigned int new_size;
+	unsigned int i_diff; /* Slots until end of array */
+
+	if (n > QUEUE_MAX_CAPACITY - queue_size(my_queue)){
+		return 1; /* Can't fit at any capacity */
+	}
+
+	new_size = queue_grown_size(my_queue, queue_size(my_queue) + n);
+
+	if (new_size != my_queue->max_size &&
+			queue_resize(my_queue, new_size)){
+		return 1;
+	}
+
+	i_diff = my_queue->max_size -
+			(my_queue->tail & (my_queue->max_size - 1));
+	if (i_diff > n){
+		i_diff = n;
+	}
+
+	memcpy(queue_calc_address(my_queue, my_queue->tail), items,
+			my_queue->el_size * i_diff);
+	memcpy(my_queue->data, items + (my_queue->el_size * i_diff),
+			my_queue->el_size * (n - i_diff));
+
+	my_queue->tail += n;
+	queue_file_mark(my_queue);
+	ds_stat_push(my_queue, n, queue_size(my_queue));
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned int queue_pop_n(queue_t *const my_queue, void *items,
+		unsigned int n){
+
+	unsigned int i_diff; /* Slots until end of array */
+
+	if (n > queue_size(my_queue)){
+		n = queue_size(my_queue);
+	}
+
+	if (items != NULL){
+		i_diff = my_queue->max_size -
+				(my_queue->head & (my_queue->max_size - 1));
+		if (i_diff > n){
+			i_diff = n;
+		}
+
+		memcpy(items, queue_calc_address(my_queue, my_queue->head),
+				my_queue->el_size * i_diff);
+		memcpy(items + (my_queue->el_size * i_diff), my_queue->data,
+				my_queue->el_size * (n - i_diff));
+	}
+
+	my_queue->head += n;
+	queue_file_mark(my_queue);
+	ds_stat_pop(my_queue, n);
+
+	queue_shrink_check(my_queue);
+	return n;
+}
+
 /* ************************************************** */
 
 unsigned int queue_front(queue_t *const my_q, void *item){
@@ -108,95 +494,170 @@ unsigned int queue_front(queue_t *const my_q, void *item){
 	void *elem_pos = queue_calc_address(my_q, my_q->head);
 
 	memcpy(item, elem_pos, my_q->el_size);
-	return my_q->size;
+	return queue_size(my_q);
 	
 }
 
 /* ************************************************** */
 
-unsigned int queue_back(queue_t *const my_q, void *item){
-
-	unsigned last_el;
+void *queue_front_ptr(queue_t *const my_q){
 
 	if (queue_empty(my_q)){
-		return 0;
+		return NULL;
+	}
+
+	return queue_calc_address(my_q, my_q->head);
+}
+
+/* ************************************************** */
+/**
+ * Items are [head, tail) around the ring: a first span from head up to
+ * the end of the array, and the rest from the start of it.
+ */
+void *queue_find(queue_t *const my_q, const void *key){
+
+	unsigned int size = queue_size(my_q);
+	unsigned int first = my_q->head & (my_q->max_size - 1);
+	unsigned int span = my_q->max_size - first;
+	size_t i;
+
+	if (span > size){
+		span = size;
 	}
 
-	/* Check if tail is at 0 to avoid overflow of integers */
-	if (my_q->tail == 0){
-		last_el = my_q->max_size;
+	i = elm_find(queue_calc_address(my_q, first), span, my_q->el_size, key);
+	if (i < span){
+		ds_stat_cmp(my_q, i + 1);
+		return queue_calc_address(my_q, first + i);
 	}
-	else{
-		last_el = my_q->tail - 1;
+
+	i = elm_find(my_q->data, size - span, my_q->el_size, key);
+	ds_stat_cmp(my_q, span + ((i < size - span) ? i + 1 : i));
+	if (i < size - span){
+		return queue_calc_address(my_q, i);
+	}
+
+	return NULL;
+}
+
+/* ************************************************** */
+
+unsigned int queue_back(queue_t *const my_q, void *item){
+
+	if (queue_empty(my_q)){
+		return 0;
 	}
 
 	/* The position where the last item is, is given by
- 	   data_start + (size_of_element * pos_of_last_element) */
-	void *elem_pos = queue_calc_address(my_q, last_el);
+ 	   data_start + (size_of_element * pos_of_last_element). The mask
+ 	   takes care of tail being 0 */
+	void *elem_pos = queue_calc_address(my_q, my_q->tail - 1);
 
 	memcpy(item, elem_pos, my_q->el_size);
-	return my_q->size;
+	return queue_size(my_q);
 	
 }
 
+
 /* ************************************************** */
+/**
+ * Like queue_find, the items are a span from head to the end of the
+ * array and the rest from its start.
+ */
+unsigned char queue_save(queue_t *const my_queue, int fd){
 
-inline unsigned char queue_full(queue_t *const my_q){
-	return (my_q->max_size == my_q->size);
-}
+	unsigned int size = queue_size(my_queue);
+	unsigned int first = my_queue->head & (my_queue->max_size - 1);
+	unsigned int span = my_queue->max_size - first;
+	struct iovec iov[2];
 
-/* ************************************************** */
+	if (span > size){
+		span = size;
+	}
+
+	iov[0].iov_base = my_queue->data + my_queue->el_size * first;
+	iov[0].iov_len = my_queue->el_size * span;
+	iov[1].iov_base = my_queue->data;
+	iov[1].iov_len = my_queue->el_size * (size - span);
 
-inline unsigned char queue_empty(queue_t *const my_q){
-	return (my_q->size == 0);
+	if (snap_write_header(fd, my_queue->el_size, size)){
+		return 1;
+	}
+
+	return snap_writev(fd, iov, 2);
 }
 
 /* ************************************************** */
 
-inline unsigned int queue_size(queue_t *const my_q){
-	return my_q->size;
-}
+unsigned char queue_load(queue_t *const my_queue, int fd){
 
+	snap_header_t hdr;
+	struct iovec iov;
+
+	if (snap_read_header(fd, &hdr) || hdr.count > QUEUE_MAX_CAPACITY){
+		return 1;
+	}
+
+	queue_init_capacity(my_queue, hdr.el_size, hdr.count);
+	if (my_queue->max_size < hdr.count){
+		queue_destroy(my_queue);
+		return 1;
+	}
+
+	iov.iov_base = my_queue->data;
+	iov.iov_len = hdr.el_size * hdr.count;
+	if (snap_readv(fd, &iov, 1)){
+		queue_destroy(my_queue);
+		return 1;
+	}
+
+	my_queue->tail = hdr.count;
+	ds_stat_push(my_queue, hdr.count, hdr.count);
+
+	return 0;
+}
 
 /*
  * Private scope function
- * Returns a 0 if could resize it, or 1 if not
+ * Returns a 0 if could resize it, or 1 if not. new_size must be a
+ * power of 2.
  */
 static unsigned char queue_resize(queue_t *my_q, unsigned int new_size){
 	void *new_data;		/* Pointer to store new data */
 	void *freed_data; 	/* Aux pointer to swap and free old buffer */
 	void *head_ptr;		/* Address of head */
-	void *next_ptr;		/* Aux pointer detailed later */
+	unsigned size = queue_size(my_q);
+	unsigned i_diff;	/* Blocks to copy until end of array */
 	
-	//Less elements than we currently have.
-	if (new_size < my_q->size)
+	//Less elements than we currently have, or caller's buffer.
+	if (new_size < size || (my_q->flags & QUEUE_STATIC))
 		return 1; 
 
+	//More bytes than a size_t holds. 0 size items fit.
+	if (my_q->el_size != 0 && new_size > SIZE_MAX / my_q->el_size)
+		return 1;
+
 	//Create new buffer
 	new_data = malloc(my_q->el_size * new_size);
+	if (new_data == NULL){
+		return 1;
+	}
 
 
-	/* Copy data. Needs to be done in various steps to keep
-	 * the queue working
+	/* Copy data. Needs to be done in two steps when the items wrap
+	 * around the end of the array: from head to end, and then from
+	 * beginning to tail.
 	 */
 	head_ptr = queue_calc_address(my_q, my_q->head);
+	i_diff = my_q->max_size - (my_q->head & (my_q->max_size - 1));
 
-	/* If head is lower or equal to tail, only need one step copy */ 
-	if (my_q->head < my_q->tail){
-		memcpy(new_data, head_ptr, my_q->el_size * my_q->size);
+	if (i_diff >= size){
+		memcpy(new_data, head_ptr, my_q->el_size * size);
 	}
-	/* In this case, we have to copy from head to end, and then
- 	 * from beginning to end.
- 	 */
  	else{
-		/* Last position to copy */
-		/* Blocks to copy until end of array */
-		unsigned i_diff = my_q->max_size - my_q->head;
 		memcpy(new_data, head_ptr, my_q->el_size * i_diff);
-		
-		/* Next no occupied address of new_data */
-		next_ptr = new_data + (my_q->el_size * i_diff);	
-		memcpy(next_ptr, my_q->data, my_q->el_size * my_q->tail);	
+		memcpy(new_data + (my_q->el_size * i_diff), my_q->data,
+				my_q->el_size * (size - i_diff));
 	}	 
 
 
@@ -205,7 +666,7 @@ static unsigned char queue_resize(queue_t *my_q, unsigned int new_size){
 	/* Point to first element, now at the beginning */
 	my_q->head = 0;
 	/* Point to last element + 1, now at the end */
-	my_q->tail = my_q->size;
+	my_q->tail = size;
 
 	//Assign new data block
 	freed_data = my_q->data;
@@ -213,6 +674,23 @@ static unsigned char queue_resize(queue_t *my_q, unsigned int new_size){
 	
 	//Free memory
 	free(freed_data);
+	ds_stat_resize(my_q, new_size, my_q->el_size * size);
 	
 	return 0;
 }
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void queue_stats_dump(queue_t *const my_queue, FILE *f){
+	ds_stats_dump(&my_queue->stats, "queue", queue_size(my_queue), f);
+}
+
+/* ************************************************** */
+
+void queue_set_resize_hook(queue_t *const my_queue, ds_resize_hook_t hook){
+	my_queue->stats.on_resize = hook;
+}
+
+#endif
@@ -9,24 +9,40 @@
 #define QUEUE_H_
 
 #include <stdlib.h> // For size_t
+#include "stats.h" // For the DS_STATS counters
+
+/*
+ * @brief Flag of queues opened with queue_open_file. Public so inline
+ * front-ends can tell them and leave them to the generic functions.
+ */
+#define QUEUE_FILE 0x04
 
 /*
  * @brief A generic queue struct using arrays as containers.
+ * The array has a power of 2 number of slots, and head and tail are free
+ * running counters masked when used as indexes, so the number of items is
+ * always tail - head and wraparound needs no branches.
  * @var data Array where data will be stored. Declared as void * to be
  * generic.
- * @var head Index to the first data introduced.
- * @var tail Index where next data should be introduced.
+ * @var head Counter of the first data introduced.
+ * @var tail Counter where next data should be introduced.
  * @var el_size Size of each element in the queue. Should be constant.
- * @var max_size Maximum size of elements in the queue.
- * @var size Current size of the queue.
+ * @var max_size Maximum size of elements in the queue. Power of 2.
+ * @var min_size Capacity automatic shrinking never goes below.
+ * @var growth Growth factor in percent, 200 doubles.
+ * @var flags Storage mode and policy bits, internal.
+ * @var stats Counters, only in DS_STATS builds.
  */
 typedef struct queue{
 	void *data;				/* Actual data, generic */
 	size_t el_size;			/* Element size. Should be constant */
 	unsigned int max_size;	/* Number of elements allocated in data */
-	unsigned int size;		/* Number of inserted elements in data. */
-	unsigned int head;		/* Pointer to next data to be returned */
-	unsigned int tail;		/* Pointer to last data inserted */
+	unsigned int head;		/* Counter of next data to be returned */
+	unsigned int tail;		/* Counter of next data to be inserted */
+	unsigned int min_size;	/* Shrink floor */
+	unsigned short growth;	/* Growth factor, percent */
+	unsigned char flags;	/* Storage mode */
+	DS_STATS_FIELD
 } queue_t; 
 
 /*
@@ -38,19 +54,124 @@ typedef struct queue{
  * @endcode 
  */
 void queue_init(queue_t *const my_q, size_t size);
+
+/*
+ * @brief Initialize a new queue with room for capacity elements, so a
+ * known working set doesn't go through the resizes of the warm up.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] capacity Initial number of elements, rounded up to a
+ * power of 2. Capped at 2^31, the biggest an unsigned int holds.
+ */
+void queue_init_capacity(queue_t *const my_q, size_t size,
+		unsigned int capacity);
+
+/*
+ * @brief Initialize a new queue over a buffer given by the caller. The
+ * queue never allocates, resizes or frees: pushes on a full queue fail
+ * instead, and every operation is O(1) with a single memcpy of el_size
+ * bytes, batches aside.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] buf Buffer with room for capacity elements.
+ * @param [in] capacity Maximum number of elements. Only the biggest
+ * power of 2 not above it is used. With 0 every push fails.
+ * @code
+ * 		static int buf[64];
+ * 		queue_init_static(&q, sizeof(int), buf, 64);
+ * @endcode 
+ */
+void queue_init_static(queue_t *const my_q, size_t size, void *buf,
+		unsigned int capacity);
  
 /*
- * @brief Destroy the queue and free its resources.
+ * @brief Opens a queue whose buffer is a file mapped in memory, so its
+ * items outlive the process. A new or empty file is set up with room for
+ * capacity elements; an existing one is reopened as it was left, head and
+ * tail included, with no parsing. Every push and pop updates the header
+ * in the file, so a restart after the process dies resumes from the last
+ * operation; surviving a system crash takes queue_sync. The queue never
+ * grows, pushes on a full one fail, and an item from queue_emplace_back
+ * counts as pushed as soon as its slot is returned. DECLARE_QUEUE
+ * functions work on it through the generic ones.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] path Path of the file, created if it doesn't exist.
+ * @param [in] size Size in bytes of a single element. Must be the one
+ * the file was created with.
+ * @param [in] capacity Number of elements of a new file, rounded up to a
+ * power of 2. Ignored when reopening.
+ * @return Status of the operation.
+ * @retval 0 Queue ready.
+ * @retval 1 Could not open or map the file, or it doesn't hold a queue
+ * of elements of that size.
+ * @code
+ * 		queue_open_file(&q, "events.q", sizeof(event_t), 4096);
+ * @endcode
+ */
+unsigned char queue_open_file(queue_t *const my_q, const char *path,
+		size_t size, unsigned int capacity);
+
+/*
+ * @brief Writes a file backed queue, items and header, to disk and waits
+ * for it. The state at that point survives a system crash.
+ * @param [in] my_q Pointer to the queue.
+ * @return Status of the operation.
+ * @retval 0 Queue on disk.
+ * @retval 1 Write failed, or the queue is not file backed.
+ */
+unsigned char queue_sync(queue_t *const my_q);
+
+/*
+ * @brief Destroy the queue and free its resources. A file backed queue
+ * is unmapped, its file left with the items still queued.
  * @param my_queue Pointer to the queue to be freed up.
  */
 void queue_destroy(queue_t *const my_queue);
 
+/*
+ * @brief Sets how the queue grows and shrinks. Capacities stay powers of
+ * 2, so growth is rounded up to the next one.
+ * With automatic shrink, a pop leaving the queue a quarter full halves the
+ * capacity, never below the initial or reserved one. The gap between both
+ * thresholds keeps push/pop bursts around one size from thrashing.
+ * @param [in] my_q Pointer to the queue.
+ * @param [in] growth Growth factor in percent, above 100. 200 doubles,
+ * the default.
+ * @param [in] auto_shrink 1 to shrink automatically, 0 to never shrink.
+ */
+void queue_set_policy(queue_t *const my_q, unsigned short growth,
+		unsigned char auto_shrink);
+
+/*
+ * @brief Makes room for at least n elements in a single resize. The
+ * capacity reserved is kept by automatic shrinking.
+ * @param [in] my_q Pointer to the queue.
+ * @param [in] n Number of elements.
+ * @return Status of the operation.
+ * @retval 0 Room available.
+ * @retval 1 Could not grow the queue, or n is above 2^31.
+ */
+unsigned char queue_reserve(queue_t *const my_q, unsigned int n);
+
+/*
+ * @brief Shrinks the buffer to the smallest power of 2 holding the
+ * current elements.
+ * @param [in] my_q Pointer to the queue.
+ * @return Status of the operation.
+ * @retval 0 Buffer shrunk.
+ * @retval 1 Could not resize, the queue is unchanged.
+ */
+unsigned char queue_shrink_to_fit(queue_t *const my_q);
+
 /*
  * @brief Adds a new element to the queue.
  * @param [in] my_queue Pointer to the queue where will add the item.
  * @param [in] item Pointer to the item to be attached.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Full queue that can't grow, nothing pushed.
  */
-void queue_push_back(queue_t *const my_queue, void *item);
+unsigned char queue_push_back(queue_t *const my_queue, void *item);
 
 /*
  * @brief Returns the top element of the queue and deletes it.
@@ -60,6 +181,31 @@ void queue_push_back(queue_t *const my_queue, void *item);
  */
 unsigned int queue_pop_front(queue_t *const my_queue, void *item);
 
+/*
+ * @brief Adds n elements to the back of the queue at once. Grows the
+ * queue at most once and copies them with at most two memcpy, split
+ * where the ring wraps.
+ * @param [in] my_queue Pointer to the queue where will add the items.
+ * @param [in] items Array of n items, items[0] goes first.
+ * @param [in] n Number of items.
+ * @return Status of the operation.
+ * @retval 0 Items pushed.
+ * @retval 1 Could not grow the queue, nothing pushed.
+ */
+unsigned char queue_push_n(queue_t *const my_queue, const void *items,
+		unsigned int n);
+
+/*
+ * @brief Removes up to n elements from the front of the queue at once,
+ * with at most two memcpy.
+ * @param [in] my_queue Pointer to the queue to be popped.
+ * @param [out] items Array with room for n items. Could be NULL.
+ * @param [in] n Maximum number of items to pop.
+ * @return Number of items popped.
+ */
+unsigned int queue_pop_n(queue_t *const my_queue, void *items,
+		unsigned int n);
+
 /*
  * @brief Gets the oldest element in the queue.
  * @param [in] my_queue Pointer to the queue to be checked.
@@ -76,6 +222,79 @@ unsigned int queue_front(queue_t *const my_queue, void *item);
  */
 unsigned int queue_back(queue_t *const my_queue, void *item);
 
+/*
+ * @brief Adds a new element to the back of the queue without copying it
+ * in. The slot returned is to be filled by the caller, and stays valid
+ * until the next call modifying the queue.
+ * @param [in] my_queue Pointer to the queue where will add the item.
+ * @return Pointer to the new back slot, uninitialized.
+ * @retval NULL Full queue that can't grow, nothing pushed.
+ */
+void *queue_emplace_back(queue_t *const my_queue);
+
+/*
+ * @brief Gets the oldest element in place, without copying it. The
+ * pointer stays valid until the next call modifying the queue.
+ * @param [in] my_queue Pointer to the queue to be checked.
+ * @return Pointer to the front element.
+ * @retval NULL Empty queue.
+ */
+void *queue_front_ptr(queue_t *const my_queue);
+
+/*
+ * @brief Finds the oldest element equal to key, byte by byte. Sizes of
+ * 1, 2, 4 and 8 bytes are compared many at a time.
+ * @param [in] my_queue Pointer to the queue to be searched.
+ * @param [in] key Pointer to the searched value.
+ * @return Pointer to the element in place, valid until the next call
+ * modifying the queue.
+ * @retval NULL Not found.
+ */
+void *queue_find(queue_t *const my_queue, const void *key);
+
+/*
+ * @brief Writes the elements to a file, front to back, after a header
+ * with their size and number (see Common/snapshot.h). The ring goes out
+ * in a single writev of at most two segments, split where it wraps.
+ * @param [in] my_queue Pointer to the queue.
+ * @param [in] fd File descriptor to write to, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 Queue saved.
+ * @retval 1 Write error.
+ */
+unsigned char queue_save(queue_t *const my_queue, int fd);
+
+/*
+ * @brief Initialize a new queue from a snapshot, like the ones written by
+ * queue_save, stack_save and list_save. The element size is the one
+ * saved, the buffer is allocated once with room for the elements saved,
+ * rounded up to a power of 2, and they're read straight into it.
+ * @param [in] my_queue Pointer to the queue to be initialized.
+ * @param [in] fd File descriptor to read from, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 Queue loaded.
+ * @retval 1 Read error, bad snapshot or out of memory. The queue is not
+ * initialized.
+ */
+unsigned char queue_load(queue_t *const my_queue, int fd);
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the queue counters to a stream, as one JSON line.
+ * @param [in] my_queue Pointer to the queue.
+ * @param [in] f Stream to write to.
+ */
+void queue_stats_dump(queue_t *const my_queue, FILE *f);
+
+/*
+ * @brief Sets a function to be called on every resize with the old and
+ * new capacity.
+ * @param [in] my_queue Pointer to the queue.
+ * @param [in] hook Function to call, NULL for none.
+ */
+void queue_set_resize_hook(queue_t *const my_queue, ds_resize_hook_t hook);
+#endif
+
 /*
  * @brief Checks if the queue is full.
  * @param [in] my_queue Pointer to the queue to be checked.
@@ -83,7 +302,10 @@ unsigned int queue_back(queue_t *const my_queue, void *item);
  * @retval 1 Full queue.
  * @retval 0 Not full queue.
  */
-inline unsigned char queue_full(queue_t *const my_q);
+static inline unsigned char queue_full(queue_t *const my_q)
+{
+	return (my_q->tail - my_q->head == my_q->max_size);
+}
 
 /*
  * @brief Checks if the queue is empty.
@@ -92,13 +314,19 @@ inline unsigned char queue_full(queue_t *const my_q);
  * @retval 1 Empty queue.
  * @retval 0 Not empty queue.
  */
-inline unsigned char queue_empty(queue_t *const my_q);
+static inline unsigned char queue_empty(queue_t *const my_q)
+{
+	return (my_q->tail == my_q->head);
+}
 
 /*
  * @brief Returns the number of allocated items.
  * @param [in] my_queue Pointer to the queue to be checked.
  * @return Number of items in the queue.
  */
-inline unsigned int queue_size(queue_t *const my_q);
+static inline unsigned int queue_size(queue_t *const my_q)
+{
+	return my_q->tail - my_q->head;
+}
 
 #endif /* QUEUE_H_ */
@@ -0,0 +1,223 @@
+#include "queue_batch.h"
+#include <stdlib.h> //For malloc and free
+#include <stddef.h> //For max_align_t
+#include <string.h>  //For memcpy
+#include <time.h>  //For clock_gettime
+
+/*
+ * @brief Block of items handed between threads.
+ * @var head Index of the next item to pop.
+ * @var count Number of items stored.
+ * @var data Items, batch * el_size bytes.
+ */
+typedef struct queue_batch_block{
+	unsigned int head;
+	unsigned int count;
+	_Alignas(max_align_t) unsigned char data[];
+} queue_batch_block_t;
+
+/* ************************************************** */
+/**
+ * @brief Current monotonic time.
+ * @return Nanoseconds.
+ */
+static inline uint64_t queue_batch_now(void){
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ************************************************** */
+/**
+ * @brief Gets an empty block, recycled if any.
+ * @param hub Pointer to the shared side.
+ * @return Block, NULL if malloc failed.
+ */
+static queue_batch_block_t *queue_batch_block_get(queue_batch_t *const hub){
+
+	queue_batch_block_t *b;
+
+	if (queue_mpmc_try_pop(&hub->empty, &b)){
+		b = malloc(sizeof(queue_batch_block_t) + hub->el_size * hub->batch);
+		if (b == NULL){
+			return NULL;
+		}
+	}
+
+	b->head = 0;
+	b->count = 0;
+
+	return b;
+}
+
+/* ************************************************** */
+/**
+ * @brief Gives a drained block back for reuse, or frees it if the
+ * recycle queue is full.
+ */
+static void queue_batch_block_put(queue_batch_t *const hub,
+		queue_batch_block_t *b){
+
+	if (queue_mpmc_try_push(&hub->empty, &b)){
+		free(b);
+	}
+}
+
+/* ************************************************** */
+
+unsigned char queue_batch_init(queue_batch_t *const hub, size_t size,
+		unsigned int batch, unsigned int slots){
+
+	if (queue_mpmc_init(&hub->full, sizeof(queue_batch_block_t *), slots)){
+		return 1;
+	}
+	if (queue_mpmc_init(&hub->empty, sizeof(queue_batch_block_t *), slots)){
+		queue_mpmc_destroy(&hub->full);
+		return 1;
+	}
+
+	hub->el_size = size;
+	hub->batch = batch ? batch : 1;
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void queue_batch_destroy(queue_batch_t *const hub){
+
+	queue_batch_block_t *b;
+
+	while (!queue_mpmc_try_pop(&hub->full, &b)){
+		free(b);
+	}
+	while (!queue_mpmc_try_pop(&hub->empty, &b)){
+		free(b);
+	}
+
+	queue_mpmc_destroy(&hub->full);
+	queue_mpmc_destroy(&hub->empty);
+}
+
+/* ************************************************** */
+
+void queue_batch_local_init(queue_batch_local_t *const my_l,
+		queue_batch_t *const hub, uint64_t max_delay_ns){
+
+	my_l->hub = hub;
+	my_l->out = NULL;
+	my_l->in = NULL;
+	my_l->out_ns = 0;
+	my_l->max_delay_ns = max_delay_ns;
+}
+
+/* ************************************************** */
+/**
+ * A partly drained block goes back to the shared side as is, its head
+ * telling the next consumer where to resume.
+ */
+unsigned char queue_batch_local_release(queue_batch_local_t *const my_l){
+
+	if (queue_batch_flush(my_l)){
+		return 1;
+	}
+
+	if (my_l->in != NULL){
+		if (my_l->in->head == my_l->in->count){
+			queue_batch_block_put(my_l->hub, my_l->in);
+		} else if (queue_mpmc_try_push(&my_l->hub->full, &my_l->in)){
+			return 1;
+		}
+		my_l->in = NULL;
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char queue_batch_flush(queue_batch_local_t *const my_l){
+
+	if (my_l->out == NULL || my_l->out->count == 0){
+		return 0;
+	}
+
+	if (queue_mpmc_try_push(&my_l->hub->full, &my_l->out)){
+		return 1;
+	}
+	my_l->out = NULL;
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * The clock is only read for the first item of a block and, with a delay
+ * limit, on every push after it.
+ */
+unsigned char queue_batch_try_push(queue_batch_local_t *const my_l,
+		const void *item){
+
+	queue_batch_t *hub = my_l->hub;
+	queue_batch_block_t *b = my_l->out;
+
+	if (b != NULL && b->count == hub->batch && queue_batch_flush(my_l)){
+		return 1; /* Full */
+	}
+
+	b = my_l->out;
+	if (b == NULL){
+		b = queue_batch_block_get(hub);
+		if (b == NULL){
+			return 1;
+		}
+		my_l->out = b;
+	}
+
+	memcpy(b->data + hub->el_size * b->count, item, hub->el_size);
+
+	if (b->count++ == 0){
+		if (my_l->max_delay_ns){
+			my_l->out_ns = queue_batch_now();
+		}
+	} else if (my_l->max_delay_ns &&
+			queue_batch_now() - my_l->out_ns >= my_l->max_delay_ns){
+		queue_batch_flush(my_l);
+		return 0;
+	}
+
+	if (b->count == hub->batch){
+		queue_batch_flush(my_l); /* If it fails, the next push retries */
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char queue_batch_try_pop(queue_batch_local_t *const my_l,
+		void *item){
+
+	queue_batch_t *hub = my_l->hub;
+	queue_batch_block_t *b = my_l->in;
+
+	if (b == NULL || b->head == b->count){
+		if (b != NULL){
+			queue_batch_block_put(hub, b);
+			my_l->in = NULL;
+		}
+		if (queue_mpmc_try_pop(&hub->full, &b)){
+			return 1; /* Empty */
+		}
+		my_l->in = b;
+	}
+
+	if (item != NULL){
+		memcpy(item, b->data + hub->el_size * b->head, hub->el_size);
+	}
+	++b->head;
+
+	return 0;
+}
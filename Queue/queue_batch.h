@@ -0,0 +1,134 @@
+/**
+ * @file queue_batch.h
+ * @author Juan Manuel Torres Palma
+ * @brief Batching front-end for shared queues declaration file
+ */
+
+#ifndef QUEUE_BATCH_H_
+#define QUEUE_BATCH_H_
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For int types
+#include "queue_mpmc.h" // For the shared batch queues
+
+/*
+ * @brief Shared side of a batched queue. Items travel between threads in
+ * blocks of up to batch elements, and only block pointers go through the
+ * lock-free queues, so producers and consumers synchronize once per
+ * block instead of once per item. Drained blocks are recycled through a
+ * second queue instead of freed.
+ * Order is kept for the items of each producer as long as there's a
+ * single consumer; with many, each one sees every producer's blocks in
+ * order, but blocks are shared out among them.
+ * @var full Blocks ready to be consumed.
+ * @var empty Drained blocks ready to be filled again.
+ * @var el_size Size of each element. Should be constant.
+ * @var batch Elements per block.
+ */
+typedef struct queue_batch{
+	queue_mpmc_t full;		/* Filled blocks */
+	queue_mpmc_t empty;		/* Recycled blocks */
+	size_t el_size;			/* Element size. Should be constant */
+	unsigned int batch;		/* Elements per block */
+} queue_batch_t;
+
+/*
+ * @brief Per thread side of a batched queue. Owned by one thread, never
+ * shared.
+ * @var hub Shared queue it feeds and drains.
+ * @var out Block being filled by pushes, NULL if none.
+ * @var in Block being drained by pops, NULL if none.
+ * @var out_ns Time the first item of out was pushed.
+ * @var max_delay_ns Time a pushed item can wait in out before a push
+ * flushes it anyway. 0 for no limit.
+ */
+typedef struct queue_batch_local{
+	queue_batch_t *hub;			/* Shared side */
+	struct queue_batch_block *out;	/* Block filling up */
+	struct queue_batch_block *in;	/* Block draining */
+	uint64_t out_ns;			/* Age of out */
+	uint64_t max_delay_ns;		/* Time trigger, 0 off */
+} queue_batch_local_t;
+
+/*
+ * @brief Initialize the shared side. Must be done before sharing it.
+ * @param [in] hub Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] batch Elements per block, at least 1.
+ * @param [in] slots Blocks that can be waiting for consumers at once,
+ * rounded up to a power of 2, at least 2.
+ * @return Status of the allocation.
+ * @retval 0 Queue ready.
+ * @retval 1 Could not allocate the block queues.
+ * @code
+ * 		queue_batch_init(&hub, sizeof(int), 64, 256);
+ * @endcode
+ */
+unsigned char queue_batch_init(queue_batch_t *const hub, size_t size,
+		unsigned int batch, unsigned int slots);
+
+/*
+ * @brief Destroy the shared side, items still queued included. Every
+ * thread must have released its local side before.
+ * @param hub Pointer to the queue to be freed up.
+ */
+void queue_batch_destroy(queue_batch_t *const hub);
+
+/*
+ * @brief Initialize the side of a thread.
+ * @param [in] my_l Pointer to the local side to be initialized.
+ * @param [in] hub Pointer to the shared side.
+ * @param [in] max_delay_ns Time limit for an item to wait in the local
+ * block, checked on each push. 0 to flush on full blocks only.
+ */
+void queue_batch_local_init(queue_batch_local_t *const my_l,
+		queue_batch_t *const hub, uint64_t max_delay_ns);
+
+/*
+ * @brief Release the side of a thread. Items pushed and not flushed, and
+ * items taken in a block and not popped, are handed to the shared side
+ * for other threads. Fails, keeping them, if the shared side is full.
+ * @param [in] my_l Pointer to the local side.
+ * @return Status of the operation.
+ * @retval 0 Released.
+ * @retval 1 Shared side full, try again.
+ */
+unsigned char queue_batch_local_release(queue_batch_local_t *const my_l);
+
+/*
+ * @brief Adds an item to the local block, handing the block to
+ * consumers when it gets full or its oldest item is older than the
+ * delay limit.
+ * @param [in] my_l Pointer to the local side.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Result of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Block full and shared side full, or no memory for a new
+ * block, nothing done.
+ */
+unsigned char queue_batch_try_push(queue_batch_local_t *const my_l,
+		const void *item);
+
+/*
+ * @brief Hands the local block to consumers even if it's not full. To
+ * be called when a producer goes idle, so its last items don't wait.
+ * @param [in] my_l Pointer to the local side.
+ * @return Status of the operation.
+ * @retval 0 Flushed, or nothing to flush.
+ * @retval 1 Shared side full, block kept.
+ */
+unsigned char queue_batch_flush(queue_batch_local_t *const my_l);
+
+/*
+ * @brief Removes an item, from the local block or else from the next
+ * block waiting in the shared side.
+ * @param [in] my_l Pointer to the local side.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Result of the operation.
+ * @retval 0 Item popped.
+ * @retval 1 No block waiting, nothing done.
+ */
+unsigned char queue_batch_try_pop(queue_batch_local_t *const my_l,
+		void *item);
+
+#endif /* QUEUE_BATCH_H_ */
@@ -0,0 +1,250 @@
+#include "queue_blocking.h"
+#include <stdint.h> //For int types
+#include <time.h>  //For clock_gettime
+#include <unistd.h>  //For sysconf
+#include <sched.h>  //For sched_yield
+#ifdef __linux__
+#include <linux/futex.h> //For FUTEX_WAIT and FUTEX_WAKE
+#include <sys/syscall.h> //For SYS_futex
+#endif
+
+#define QUEUE_SPIN_MAX 4096 //Adaptive spin ceiling
+#define QUEUE_SPIN_MIN 16 //Adaptive spin floor, multi core
+
+/* ************************************************** */
+/**
+ * @brief Hint for the core that this is a spin loop.
+ */
+static inline void queue_cpu_relax(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+/* ************************************************** */
+/**
+ * @brief Current monotonic time.
+ * @return Nanoseconds.
+ */
+static inline unsigned long long queue_now(void){
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ************************************************** */
+/**
+ * @brief Sleeps while a word still holds a value, at most timeout_ns.
+ * May return early, callers check again. Without futexes it just gives
+ * the core away once.
+ * @param word Word to watch.
+ * @param val Value it had when the caller decided to sleep.
+ * @param timeout_ns Longest sleep, 0 for no limit.
+ */
+static void queue_futex_wait(atomic_uint *word, unsigned int val,
+		unsigned long long timeout_ns){
+#ifdef __linux__
+	struct timespec ts = {timeout_ns / 1000000000ULL,
+			timeout_ns % 1000000000ULL};
+
+	syscall(SYS_futex, (uint32_t *) word, FUTEX_WAIT_PRIVATE, val,
+			timeout_ns ? &ts : NULL, NULL, 0);
+#else
+	sched_yield();
+#endif
+}
+
+/* ************************************************** */
+/**
+ * @brief Wakes up one thread sleeping on a word, one per change is
+ * enough as each change lets one waiter through.
+ */
+static void queue_futex_wake(atomic_uint *word){
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t *) word, FUTEX_WAKE_PRIVATE, 1,
+			NULL, NULL, 0);
+#endif
+}
+
+/* ************************************************** */
+/**
+ * @brief Bumps a sequence word after a change and wakes its sleepers if
+ * there's any. Paired with queue_wait: either the waiter count is seen
+ * here, or the new sequence is seen there before going to sleep.
+ */
+static inline void queue_notify(atomic_uint *word, atomic_uint *waiters){
+
+	atomic_fetch_add(word, 1);
+	if (atomic_load(waiters) != 0){
+		queue_futex_wake(word);
+	}
+}
+
+/* ************************************************** */
+/**
+ * @brief Waits until a sequence word moves from seq or the deadline
+ * passes. Spins first, and sleeps if nothing changed. The spin budget
+ * doubles when spinning was enough and halves when it wasn't.
+ * @param my_q Pointer to the queue.
+ * @param word Sequence word to watch.
+ * @param waiters Waiter count of that word.
+ * @param seq Value read before the queue was found empty or full.
+ * @param deadline Time to give up at, 0 for none.
+ * @return 0 if the word moved or might have, 1 on deadline.
+ */
+static unsigned char queue_wait(queue_blocking_t *const my_q,
+		atomic_uint *word, atomic_uint *waiters, unsigned int seq,
+		unsigned long long deadline){
+
+	unsigned int spin = atomic_load_explicit(&my_q->spin,
+			memory_order_relaxed);
+	unsigned long long now = 0;
+	unsigned int i;
+
+	for (i = 0; i < spin; ++i){
+		if (atomic_load_explicit(word, memory_order_relaxed) != seq){
+			if (spin < QUEUE_SPIN_MAX){
+				atomic_store_explicit(&my_q->spin, spin * 2,
+						memory_order_relaxed);
+			}
+			return 0;
+		}
+		queue_cpu_relax();
+	}
+
+	if (spin > QUEUE_SPIN_MIN){
+		atomic_store_explicit(&my_q->spin, spin / 2, memory_order_relaxed);
+	}
+
+	if (deadline){
+		now = queue_now();
+		if (now >= deadline){
+			return 1;
+		}
+	}
+
+	atomic_fetch_add(waiters, 1);
+	queue_futex_wait(word, seq, deadline ? deadline - now : 0);
+	atomic_fetch_sub(waiters, 1);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * @brief Pops if there's an item, under the lock.
+ * @return 1 if popped, 0 if empty.
+ */
+static unsigned char queue_try_pop_locked(queue_blocking_t *const my_q,
+		void *item, unsigned int *left){
+
+	unsigned char got;
+
+	pthread_mutex_lock(&my_q->lock);
+	got = !queue_empty(&my_q->q);
+	if (got){
+		*left = queue_pop_front(&my_q->q, item);
+	}
+	pthread_mutex_unlock(&my_q->lock);
+
+	if (got){
+		queue_notify(&my_q->popped, &my_q->push_waiters);
+	}
+
+	return got;
+}
+
+/* ************************************************** */
+/**
+ * Single core machines don't spin at all: the thread that would change
+ * the word can't run while this one spins.
+ */
+void queue_blocking_init(queue_blocking_t *const my_q, size_t size,
+		unsigned int max_items){
+
+	queue_init(&my_q->q, size);
+	pthread_mutex_init(&my_q->lock, NULL);
+	atomic_init(&my_q->pushed, 0);
+	atomic_init(&my_q->popped, 0);
+	atomic_init(&my_q->pop_waiters, 0);
+	atomic_init(&my_q->push_waiters, 0);
+	atomic_init(&my_q->spin,
+			(sysconf(_SC_NPROCESSORS_ONLN) > 1) ? QUEUE_SPIN_MIN : 0);
+	my_q->max_items = max_items;
+}
+
+/* ************************************************** */
+
+void queue_blocking_destroy(queue_blocking_t *const my_q){
+	pthread_mutex_destroy(&my_q->lock);
+	queue_destroy(&my_q->q);
+}
+
+/* ************************************************** */
+
+unsigned char queue_push_wait(queue_blocking_t *const my_q,
+		const void *item){
+
+	unsigned int seq;
+	unsigned char err;
+
+	for (;;){
+		seq = atomic_load(&my_q->popped);
+
+		pthread_mutex_lock(&my_q->lock);
+		if (my_q->max_items == 0 ||
+				queue_size(&my_q->q) < my_q->max_items){
+			err = queue_push_back(&my_q->q, (void *) item);
+			pthread_mutex_unlock(&my_q->lock);
+			break;
+		}
+		pthread_mutex_unlock(&my_q->lock);
+
+		queue_wait(my_q, &my_q->popped, &my_q->push_waiters, seq, 0);
+	}
+
+	if (!err){
+		queue_notify(&my_q->pushed, &my_q->pop_waiters);
+	}
+
+	return err;
+}
+
+/* ************************************************** */
+
+unsigned int queue_pop_wait(queue_blocking_t *const my_q, void *item){
+
+	unsigned int seq, left;
+
+	for (;;){
+		seq = atomic_load(&my_q->pushed);
+		if (queue_try_pop_locked(my_q, item, &left)){
+			return left;
+		}
+		queue_wait(my_q, &my_q->pushed, &my_q->pop_waiters, seq, 0);
+	}
+}
+
+/* ************************************************** */
+
+unsigned char queue_pop_timed(queue_blocking_t *const my_q, void *item,
+		unsigned long long timeout_ns){
+
+	unsigned long long deadline = queue_now() + timeout_ns;
+	unsigned int seq, left;
+
+	for (;;){
+		seq = atomic_load(&my_q->pushed);
+		if (queue_try_pop_locked(my_q, item, &left)){
+			return 0;
+		}
+		if (timeout_ns == 0 || queue_wait(my_q, &my_q->pushed,
+				&my_q->pop_waiters, seq, deadline)){
+			return 1; /* Timed out */
+		}
+	}
+}
@@ -0,0 +1,95 @@
+/**
+ * @file queue_blocking.h
+ * @author Juan Manuel Torres Palma
+ * @brief Blocking queue declaration file
+ */
+
+#ifndef QUEUE_BLOCKING_H_
+#define QUEUE_BLOCKING_H_
+
+#include <stdlib.h> // For size_t
+#include <stdatomic.h> // For the wait words
+#include <pthread.h> // For the queue lock
+#include "queue.h"
+
+/*
+ * @brief A queue_t threads can wait on: pops block while it's empty and,
+ * if bounded, pushes block while it's full. The queue itself is guarded
+ * by a mutex. Waiting threads spin a little watching a sequence word
+ * bumped on every change, and then sleep on it (a futex on Linux), and
+ * the side making the change only calls the kernel to wake them up when
+ * the waiter count says somebody sleeps.
+ * @var q Queue holding the items.
+ * @var lock Mutex guarding q.
+ * @var pushed Sequence bumped after each push, waited on by pops.
+ * @var popped Sequence bumped after each pop, waited on by pushes.
+ * @var pop_waiters Threads sleeping or about to sleep on pushed.
+ * @var push_waiters Threads sleeping or about to sleep on popped.
+ * @var spin Rounds to spin before sleeping, tuned as the queue is used.
+ * @var max_items Bound on the number of items, 0 for none.
+ */
+typedef struct queue_blocking{
+	queue_t q;					/* Items */
+	pthread_mutex_t lock;		/* Guards q */
+	atomic_uint pushed;			/* Pop wait word */
+	atomic_uint popped;			/* Push wait word */
+	atomic_uint pop_waiters;	/* Sleeping poppers */
+	atomic_uint push_waiters;	/* Sleeping pushers */
+	atomic_uint spin;			/* Adaptive spin rounds */
+	unsigned int max_items;		/* Bound, 0 none */
+} queue_blocking_t;
+
+/*
+ * @brief Initialize a new blocking queue. Must be done before sharing it.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] max_items Items at which pushes block, 0 to never block
+ * them and let the queue grow.
+ * @code
+ * 		queue_blocking_init(&q, sizeof(int), 1024);
+ * @endcode
+ */
+void queue_blocking_init(queue_blocking_t *const my_q, size_t size,
+		unsigned int max_items);
+
+/*
+ * @brief Destroy the queue and free its resources. No thread can be
+ * using it or waiting on it anymore.
+ * @param my_q Pointer to the queue to be freed up.
+ */
+void queue_blocking_destroy(queue_blocking_t *const my_q);
+
+/*
+ * @brief Adds a new element to the queue, waiting while it's full.
+ * @param [in] my_q Pointer to the queue where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 The queue could not grow, nothing pushed.
+ */
+unsigned char queue_push_wait(queue_blocking_t *const my_q,
+		const void *item);
+
+/*
+ * @brief Removes the oldest element of the queue, waiting while it's
+ * empty.
+ * @param [in] my_q Pointer to the queue to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Number of elements remaining in the queue.
+ */
+unsigned int queue_pop_wait(queue_blocking_t *const my_q, void *item);
+
+/*
+ * @brief Removes the oldest element of the queue, waiting at most
+ * timeout_ns for one to arrive.
+ * @param [in] my_q Pointer to the queue to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @param [in] timeout_ns Longest wait, 0 to only check.
+ * @return Result of the operation.
+ * @retval 0 Item popped.
+ * @retval 1 Timed out, nothing done.
+ */
+unsigned char queue_pop_timed(queue_blocking_t *const my_q, void *item,
+		unsigned long long timeout_ns);
+
+#endif /* QUEUE_BLOCKING_H_ */
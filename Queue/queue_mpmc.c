@@ -0,0 +1,153 @@
+#include "queue_mpmc.h"
+#include <stdlib.h> //For malloc and free
+#include <stddef.h> //For max_align_t
+#include <string.h>  //For memcpy
+
+/* Alignment of the items inside the slots, the same malloc gives */
+#define QUEUE_MPMC_ALIGN _Alignof(max_align_t)
+
+/* Offset of the item inside a slot, after the sequence number */
+#define QUEUE_MPMC_DATA_OFF	\
+	((sizeof(atomic_uint) + QUEUE_MPMC_ALIGN - 1) & ~(QUEUE_MPMC_ALIGN - 1))
+
+/**
+ * @brief Macro to easily get the slot of a free running position.
+ * @param queue Pointer to the queue structure.
+ * @param pos Position that we want the slot of.
+ */
+#define queue_mpmc_cell(queue,pos)			\
+	((atomic_uint *) (queue->cells + queue->stride * ((pos) & queue->mask)))
+
+/**
+ * @brief Macro to get the item address of a slot.
+ * @param cell Pointer to the slot.
+ */
+#define queue_mpmc_cell_data(cell)			\
+	((unsigned char *) (cell) + QUEUE_MPMC_DATA_OFF)
+
+/* ************************************************** */
+/**
+ * Slot i starts with sequence i, meaning free for the push at position i.
+ * A single slot can't work: its sequence after a push, pos + 1, is also
+ * the one that frees it for the next push, so a second push would
+ * overwrite the item and the pop would wait for a lap that never comes.
+ * Hence the minimum of 2.
+ */
+unsigned char queue_mpmc_init(queue_mpmc_t *const my_q, size_t size,
+		unsigned int slots){
+
+	unsigned int max_size = 2;
+	unsigned int i;
+
+	/* Biggest power of 2 an unsigned int holds */
+	if (slots > (~0u >> 1) + 1){
+		return 1;
+	}
+
+	/* Round up to a power of 2 */
+	while (max_size < slots){
+		max_size <<= 1;
+	}
+
+	my_q->el_size = size;
+	my_q->mask = max_size - 1;
+	my_q->stride = (QUEUE_MPMC_DATA_OFF + size + QUEUE_MPMC_ALIGN - 1) &
+			~(QUEUE_MPMC_ALIGN - 1);
+
+	my_q->cells = malloc(my_q->stride * max_size);
+	if (my_q->cells == NULL){
+		return 1;
+	}
+
+	for (i = 0; i < max_size; ++i){
+		atomic_init(queue_mpmc_cell(my_q, i), i);
+	}
+	atomic_init(&my_q->head, 0);
+	atomic_init(&my_q->tail, 0);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void queue_mpmc_destroy(queue_mpmc_t *const my_q){
+	free(my_q->cells);
+}
+
+/* ************************************************** */
+/**
+ * A slot whose sequence equals the position is free for this lap. The
+ * producer claims the position by moving tail with a CAS, fills the slot
+ * and releases it to consumers with sequence pos + 1. A sequence behind
+ * the position means the consumer of the previous lap isn't done, so the
+ * queue is full.
+ */
+unsigned char queue_mpmc_try_push(queue_mpmc_t *const my_q,
+		const void *item){
+
+	unsigned int pos = atomic_load_explicit(&my_q->tail,
+			memory_order_relaxed);
+	atomic_uint *cell;
+	int dif;
+
+	for (;;){
+		cell = queue_mpmc_cell(my_q, pos);
+		dif = (int) (atomic_load_explicit(cell, memory_order_acquire) - pos);
+
+		if (dif == 0){
+			if (atomic_compare_exchange_weak_explicit(&my_q->tail, &pos,
+					pos + 1, memory_order_relaxed, memory_order_relaxed)){
+				break;
+			}
+			/* Lost the race, pos holds the new tail */
+		} else if (dif < 0){
+			return 1; /* Full */
+		} else {
+			/* Another producer took it already */
+			pos = atomic_load_explicit(&my_q->tail, memory_order_relaxed);
+		}
+	}
+
+	memcpy(queue_mpmc_cell_data(cell), item, my_q->el_size);
+	atomic_store_explicit(cell, pos + 1, memory_order_release);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * Mirror of the push. A slot is ready to be read when its sequence is
+ * pos + 1, and after copying the item out it's handed to the producer of
+ * the next lap with sequence pos + slots.
+ */
+unsigned char queue_mpmc_try_pop(queue_mpmc_t *const my_q, void *item){
+
+	unsigned int pos = atomic_load_explicit(&my_q->head,
+			memory_order_relaxed);
+	atomic_uint *cell;
+	int dif;
+
+	for (;;){
+		cell = queue_mpmc_cell(my_q, pos);
+		dif = (int) (atomic_load_explicit(cell, memory_order_acquire) -
+				(pos + 1));
+
+		if (dif == 0){
+			if (atomic_compare_exchange_weak_explicit(&my_q->head, &pos,
+					pos + 1, memory_order_relaxed, memory_order_relaxed)){
+				break;
+			}
+		} else if (dif < 0){
+			return 1; /* Empty */
+		} else {
+			pos = atomic_load_explicit(&my_q->head, memory_order_relaxed);
+		}
+	}
+
+	if (item != NULL){
+		memcpy(item, queue_mpmc_cell_data(cell), my_q->el_size);
+	}
+	atomic_store_explicit(cell, pos + my_q->mask + 1, memory_order_release);
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file queue_mpmc.h
+ * @author Juan Manuel Torres Palma
+ * @brief Lock-free bounded multi producer, multi consumer queue
+ * declaration file
+ */
+
+#ifndef QUEUE_MPMC_H_
+#define QUEUE_MPMC_H_
+
+#include <stdlib.h> // For size_t
+#include <stdatomic.h> // For atomic indexes
+#include "queue_spsc.h" // For QUEUE_CACHE_LINE
+
+/*
+ * @brief A generic bounded queue any number of threads can push to and
+ * pop from at the same time. Every slot carries a sequence number that
+ * tells whether it's ready to be written or read for a given lap of the
+ * ring, so producers only compete on tail and consumers on head, and
+ * never on each other's index.
+ * Capacity is a fixed power of 2 and the buffer is never reallocated.
+ * @var tail Position of the next push. Claimed by producers.
+ * @var head Position of the next pop. Claimed by consumers.
+ * @var cells Slot array, each one a sequence number plus the item.
+ * @var el_size Size of each element in the queue. Should be constant.
+ * @var stride Bytes per slot.
+ * @var mask Number of slots minus one.
+ */
+typedef struct queue_mpmc{
+	_Alignas(QUEUE_CACHE_LINE) atomic_uint tail;	/* Producers index */
+	_Alignas(QUEUE_CACHE_LINE) atomic_uint head;	/* Consumers index */
+	_Alignas(QUEUE_CACHE_LINE) unsigned char *cells;/* Slots */
+	size_t el_size;			/* Element size. Should be constant */
+	size_t stride;			/* Slot size, sequence included */
+	unsigned int mask;		/* Slots - 1, slots is a power of 2 */
+} queue_mpmc_t;
+
+/*
+ * @brief Initialize a new queue. Must be done before sharing it.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] slots Capacity, rounded up to a power of 2, at least 2.
+ * @return Status of the allocation.
+ * @retval 0 Queue ready.
+ * @retval 1 Could not allocate the buffer.
+ * @code
+ * 		queue_mpmc_init(&q, sizeof(int), 1024);
+ * @endcode
+ */
+unsigned char queue_mpmc_init(queue_mpmc_t *const my_q, size_t size,
+		unsigned int slots);
+
+/*
+ * @brief Destroy the queue and free its resources. No thread can be
+ * using it anymore.
+ * @param my_q Pointer to the queue to be freed up.
+ */
+void queue_mpmc_destroy(queue_mpmc_t *const my_q);
+
+/*
+ * @brief Adds a new element to the queue if there's room.
+ * @param [in] my_q Pointer to the queue where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Result of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Full queue, nothing done.
+ */
+unsigned char queue_mpmc_try_push(queue_mpmc_t *const my_q,
+		const void *item);
+
+/*
+ * @brief Removes the oldest element of the queue if any.
+ * @param [in] my_q Pointer to the queue to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Result of the operation.
+ * @retval 0 Item popped.
+ * @retval 1 Empty queue, nothing done.
+ */
+unsigned char queue_mpmc_try_pop(queue_mpmc_t *const my_q, void *item);
+
+/*
+ * @brief Returns the capacity of the queue.
+ * @param [in] my_q Pointer to the queue to be checked.
+ * @return Number of slots.
+ */
+static inline unsigned int queue_mpmc_capacity(queue_mpmc_t *const my_q)
+{
+	return my_q->mask + 1;
+}
+
+#endif /* QUEUE_MPMC_H_ */
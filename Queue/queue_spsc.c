@@ -0,0 +1,103 @@
+#include "queue_spsc.h"
+#include <stdlib.h> //For malloc and free
+#include <string.h>  //For memcpy
+
+/**
+ * @brief Macro to easily get the address from a free running index.
+ * @param queue Pointer to the queue structure.
+ * @param indx Index that we want to ge the address of.
+ */
+#define queue_spsc_calc_address(queue,indx)			\
+	 queue->data + (queue->el_size * ((indx) & queue->mask))
+
+/* ************************************************** */
+
+unsigned char queue_spsc_init(queue_spsc_t *const my_q, size_t size,
+		unsigned int slots){
+
+	unsigned int max_size = 1;
+
+	/* Biggest power of 2 an unsigned int holds */
+	if (slots > (~0u >> 1) + 1){
+		return 1;
+	}
+
+	/* Round up to a power of 2 */
+	while (max_size < slots){
+		max_size <<= 1;
+	}
+
+	my_q->data = malloc(size * max_size);
+	if (my_q->data == NULL){
+		return 1;
+	}
+
+	my_q->el_size = size;
+	my_q->mask = max_size - 1;
+	my_q->head_cache = 0;
+	my_q->tail_cache = 0;
+	atomic_init(&my_q->head, 0);
+	atomic_init(&my_q->tail, 0);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void queue_spsc_destroy(queue_spsc_t *const my_q){
+	free(my_q->data);
+}
+
+/* ************************************************** */
+/**
+ * The producer owns tail, so it's read relaxed. Head is only reloaded,
+ * with acquire to see the consumer done with the slot, when the cached
+ * copy says the queue is full. The release store of tail publishes the
+ * copied item.
+ */
+unsigned char queue_spsc_try_push(queue_spsc_t *const my_q,
+		const void *item){
+
+	unsigned int tail = atomic_load_explicit(&my_q->tail,
+			memory_order_relaxed);
+
+	if (tail - my_q->head_cache > my_q->mask){
+		my_q->head_cache = atomic_load_explicit(&my_q->head,
+				memory_order_acquire);
+		if (tail - my_q->head_cache > my_q->mask){
+			return 1; /* Full */
+		}
+	}
+
+	memcpy(queue_spsc_calc_address(my_q, tail), item, my_q->el_size);
+	atomic_store_explicit(&my_q->tail, tail + 1, memory_order_release);
+
+	return 0;
+}
+
+/* ************************************************** */
+/**
+ * Mirror of the push. Tail is reloaded with acquire only when the cached
+ * copy says the queue is empty, and the release store of head gives the
+ * slot back to the producer.
+ */
+unsigned char queue_spsc_try_pop(queue_spsc_t *const my_q, void *item){
+
+	unsigned int head = atomic_load_explicit(&my_q->head,
+			memory_order_relaxed);
+
+	if (head == my_q->tail_cache){
+		my_q->tail_cache = atomic_load_explicit(&my_q->tail,
+				memory_order_acquire);
+		if (head == my_q->tail_cache){
+			return 1; /* Empty */
+		}
+	}
+
+	if (item != NULL){
+		memcpy(item, queue_spsc_calc_address(my_q, head), my_q->el_size);
+	}
+	atomic_store_explicit(&my_q->head, head + 1, memory_order_release);
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file queue_spsc.h
+ * @author Juan Manuel Torres Palma
+ * @brief Lock-free single producer, single consumer queue declaration file
+ */
+
+#ifndef QUEUE_SPSC_H_
+#define QUEUE_SPSC_H_
+
+#include <stdlib.h> // For size_t
+#include <stdatomic.h> // For atomic indexes
+
+#define QUEUE_CACHE_LINE 64 // Bytes per cache line
+
+/*
+ * @brief A generic circular buffer safe to be used by exactly one producer
+ * thread and one consumer thread at the same time, without locks.
+ * Capacity is a fixed power of 2, and head and tail are free running
+ * counters masked on access, so there is no shared size field. Each index
+ * lives in its own cache line next to a private copy of the other one,
+ * refreshed only when the queue looks full or empty.
+ * @var head Index of the next item to pop. Written by the consumer.
+ * @var tail_cache Consumer copy of tail.
+ * @var tail Index where the next item is pushed. Written by the producer.
+ * @var head_cache Producer copy of head.
+ * @var data Array where data will be stored.
+ * @var el_size Size of each element in the queue. Should be constant.
+ * @var mask Number of slots minus one.
+ */
+typedef struct queue_spsc{
+	_Alignas(QUEUE_CACHE_LINE) atomic_uint head;	/* Consumer index */
+	unsigned int tail_cache;						/* Last tail seen */
+	_Alignas(QUEUE_CACHE_LINE) atomic_uint tail;	/* Producer index */
+	unsigned int head_cache;						/* Last head seen */
+	_Alignas(QUEUE_CACHE_LINE) void *data;			/* Actual data */
+	size_t el_size;			/* Element size. Should be constant */
+	unsigned int mask;		/* Slots - 1, slots is a power of 2 */
+} queue_spsc_t;
+
+/*
+ * @brief Initialize a new queue. Must be done before sharing it.
+ * @param [in] my_q Pointer to the queue to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] slots Capacity, rounded up to a power of 2.
+ * @return Status of the allocation.
+ * @retval 0 Queue ready.
+ * @retval 1 Could not allocate the buffer.
+ * @code
+ * 		queue_spsc_init(&q, sizeof(int), 1024);
+ * @endcode
+ */
+unsigned char queue_spsc_init(queue_spsc_t *const my_q, size_t size,
+		unsigned int slots);
+
+/*
+ * @brief Destroy the queue and free its resources. No thread can be
+ * using it anymore.
+ * @param my_q Pointer to the queue to be freed up.
+ */
+void queue_spsc_destroy(queue_spsc_t *const my_q);
+
+/*
+ * @brief Adds a new element to the queue if there's room. Only to be
+ * called from the producer thread.
+ * @param [in] my_q Pointer to the queue where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Result of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Full queue, nothing done.
+ */
+unsigned char queue_spsc_try_push(queue_spsc_t *const my_q,
+		const void *item);
+
+/*
+ * @brief Removes the oldest element of the queue if any. Only to be
+ * called from the consumer thread.
+ * @param [in] my_q Pointer to the queue to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Result of the operation.
+ * @retval 0 Item popped.
+ * @retval 1 Empty queue, nothing done.
+ */
+unsigned char queue_spsc_try_pop(queue_spsc_t *const my_q, void *item);
+
+/*
+ * @brief Returns the capacity of the queue.
+ * @param [in] my_q Pointer to the queue to be checked.
+ * @return Number of slots.
+ */
+static inline unsigned int queue_spsc_capacity(queue_spsc_t *const my_q)
+{
+	return my_q->mask + 1;
+}
+
+#endif /* QUEUE_SPSC_H_ */
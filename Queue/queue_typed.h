@@ -0,0 +1,90 @@
+/**
+ * @file queue_typed.h
+ * @author Juan Manuel Torres Palma
+ * @brief Type specialized front-end over the generic C queue
+ */
+
+#ifndef QUEUE_TYPED_H_
+#define QUEUE_TYPED_H_
+
+#include "queue.h"
+
+/*
+ * @brief Generates inline functions to use a queue_t holding elements of
+ * a known type. Element size is a compile time constant, so copies become
+ * plain loads and stores. The queue is a regular queue_t, and the slow
+ * paths, growth included, go through the generic functions, so both APIs
+ * can be mixed on the same queue. So do pushes and pops on queues from
+ * queue_open_file, which must keep the file header up to date. Typed
+ * pushes and pops update the DS_STATS counters too. Typed pops never
+ * trigger automatic shrinking, use queue_shrink_to_fit for that.
+ * Only the types actually used pay the extra code size.
+ * @param name Suffix of the generated functions.
+ * @param type Element type.
+ * @code
+ * 		DECLARE_QUEUE(int32, int32_t)
+ *
+ * 		queue_int32_init(&q);
+ * 		queue_int32_push_back(&q, 42);
+ * 		queue_int32_pop_front(&q, &v);
+ * @endcode
+ */
+#define DECLARE_QUEUE(name, type)											\
+																			\
+static inline void queue_##name##_init(queue_t *const my_q)					\
+{																			\
+	queue_init(my_q, sizeof(type));											\
+}																			\
+																			\
+static inline type *queue_##name##_slot(queue_t *const my_q,				\
+		unsigned int indx)													\
+{																			\
+	return (type *) my_q->data + (indx & (my_q->max_size - 1));				\
+}																			\
+																			\
+static inline unsigned char queue_##name##_push_back(queue_t *const my_q,	\
+		type item)															\
+{																			\
+	if (queue_full(my_q) || (my_q->flags & QUEUE_FILE)){					\
+		return queue_push_back(my_q, &item);								\
+	}																		\
+	*queue_##name##_slot(my_q, my_q->tail++) = item;						\
+	ds_stat_push(my_q, 1, queue_size(my_q));								\
+	return 0;																\
+}																			\
+																			\
+static inline unsigned int queue_##name##_pop_front(queue_t *const my_q,	\
+		type *item)															\
+{																			\
+	if (my_q->flags & QUEUE_FILE){											\
+		return queue_pop_front(my_q, item);									\
+	}																		\
+	if (queue_empty(my_q)){													\
+		return 0;															\
+	}																		\
+	*item = *queue_##name##_slot(my_q, my_q->head++);						\
+	ds_stat_pop(my_q, 1);													\
+	return queue_size(my_q);												\
+}																			\
+																			\
+static inline unsigned int queue_##name##_front(queue_t *const my_q,		\
+		type *item)															\
+{																			\
+	if (queue_empty(my_q)){													\
+		return 0;															\
+	}																		\
+	*item = *queue_##name##_slot(my_q, my_q->head);							\
+	return queue_size(my_q);												\
+}																			\
+																			\
+static inline unsigned int queue_##name##_back(queue_t *const my_q,		\
+		type *item)															\
+{																			\
+	if (queue_empty(my_q)){													\
+		return 0;															\
+	}																		\
+	*item = *queue_##name##_slot(my_q, my_q->tail - 1);						\
+	return queue_size(my_q);												\
+}
+
+#endif /* QUEUE_TYPED_H_ */
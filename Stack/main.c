@@ -23,6 +23,9 @@ int main (int argc, char *argv[]){
 		printf("%c, %u\n", b, stack_size(&s));
 	}
 
+#ifdef DS_STATS
+	stack_stats_dump(&s, stdout);
+#endif
 	stack_destroy(&s);
 	
 	return 0;
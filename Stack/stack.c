@@ -1,43 +1,183 @@
+#define _GNU_SOURCE  //For mremap
 #include "stack.h"
-#include <stdlib.h> //For malloc and free
+#include <stdlib.h> //For malloc, realloc and free
 #include <string.h>  //For memcpy
+#include "find.h" //For elm_find
+#include "snapshot.h" //For the snapshot format
+#include <unistd.h>  //For sysconf
+#include <sys/mman.h> //For mmap, mremap and munmap
 
 #define DEFAULT_STACK_ELM 5
+#define DEFAULT_STACK_GROWTH 200 //Percent, doubles
+
+/* Buffers of this many bytes or more are anonymous mappings */
+#define STACK_MMAP_THRESHOLD (1UL << 20)
+
+#define STACK_STATIC 0x01 //Buffer owned by the caller, never resized
+#define STACK_SHRINK 0x02 //Shrink automatically on pop
+#define STACK_MMAP 0x04 //Buffer is an anonymous mapping
 
 
 #define stack_calc_address(stack, indx) 		\
-	stack->data + (stack->el_size * indx)
+	stack->data + (stack->el_size * (indx))
 
 static unsigned char stack_resize(stack_t *my_s, unsigned int new_size);
 
+/* ************************************************** */
+/**
+ * @brief Rounds a buffer size up to whole pages, the length of its mapping.
+ * @param bytes Size of the buffer.
+ * @return Length of the mapping.
+ */
+static inline size_t stack_map_len(size_t bytes){
+
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	return (bytes + page - 1) & ~(page - 1);
+}
+
+/* ************************************************** */
+/**
+ * @brief Computes the capacity after growing until needed elements fit.
+ * Each step grows by the growth factor, and at least by one element.
+ * @param my_s Pointer to the stack.
+ * @param needed Number of elements that must fit.
+ * @return New capacity.
+ */
+static unsigned int stack_grown_size(stack_t *const my_s,
+		unsigned int needed){
+
+	unsigned long long new_size = my_s->max_size;
+
+	while (new_size < needed){
+		new_size = new_size * my_s->growth / 100 + 1;
+	}
+
+	return (new_size > ~0u) ? ~0u : new_size;
+}
+
+/* ************************************************** */
+/**
+ * @brief Halves the capacity once the stack is a quarter full, if
+ * automatic shrink is on. Not going below min_size.
+ * @param my_s Pointer to the stack.
+ */
+static inline void stack_shrink_check(stack_t *const my_s){
+
+	unsigned int new_size = my_s->max_size / 2;
+
+	if ((my_s->flags & STACK_SHRINK) && my_s->size <= my_s->max_size / 4 &&
+			new_size >= my_s->min_size && new_size > 0){
+		stack_resize(my_s, new_size);
+	}
+}
+
 /* ************************************************** */
 
 void stack_init(stack_t *const my_s, size_t size){
+	stack_init_capacity(my_s, size, DEFAULT_STACK_ELM); // Five spots
+}
+
+/* ************************************************** */
+
+void stack_init_capacity(stack_t *const my_s, size_t size,
+		unsigned int capacity){
 
 	my_s->el_size = size; 			 // Data size
-	my_s->max_size = DEFAULT_STACK_ELM;// Five spots
+	my_s->max_size = 0;
+	my_s->min_size = capacity ? capacity : 1;
 	my_s->size = 0; 				 // Zero elements initially.	
+	my_s->growth = DEFAULT_STACK_GROWTH;
+	my_s->flags = 0;
+	my_s->data = NULL;
+	ds_stat_init(my_s, 0);
+
+	/* Create data array. If it fails the stack stays with no room, and
+	   the first push tries again */
+	stack_resize(my_s, my_s->min_size);
 
-	my_s->data = malloc((size_t)size * my_s->max_size); //Create data array
+}
+
+/* ************************************************** */
 
+void stack_init_static(stack_t *const my_s, size_t size, void *buf,
+		unsigned int capacity){
+
+	my_s->el_size = size;
+	my_s->max_size = capacity;
+	my_s->min_size = capacity;
+	my_s->size = 0;
+	my_s->growth = DEFAULT_STACK_GROWTH;
+	my_s->flags = STACK_STATIC;
+	my_s->data = buf;
+	ds_stat_init(my_s, capacity);
 }
 
 /* ************************************************** */
 
 void stack_destroy(stack_t *const my_stack){
-	free(my_stack->data);
+	if (my_stack->flags & STACK_MMAP){
+		munmap(my_stack->data, stack_map_len(my_stack->el_size *
+				my_stack->max_size));
+	} else if (!(my_stack->flags & STACK_STATIC)){
+		free(my_stack->data);
+	}
 }
 
 /* ************************************************** */
 
-void stack_push(stack_t *const my_stack, void *item){
+void stack_set_policy(stack_t *const my_s, unsigned short growth,
+		unsigned char auto_shrink){
+
+	my_s->growth = (growth > 100) ? growth : DEFAULT_STACK_GROWTH;
+
+	if (auto_shrink){
+		my_s->flags |= STACK_SHRINK;
+	} else {
+		my_s->flags &= ~STACK_SHRINK;
+	}
+}
+
+/* ************************************************** */
+
+unsigned char stack_reserve(stack_t *const my_s, unsigned int n){
+
+	if (n > my_s->max_size && stack_resize(my_s, n)){
+		return 1;
+	}
+
+	if (n > my_s->min_size){
+		my_s->min_size = n;
+	}
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char stack_shrink_to_fit(stack_t *const my_s){
+
+	unsigned int new_size = my_s->size ? my_s->size : 1;
+
+	if (new_size == my_s->max_size){
+		return 0;
+	}
+
+	return stack_resize(my_s, new_size);
+}
+
+/* ************************************************** */
+
+unsigned char stack_push(stack_t *const my_stack, void *item){
 	/* The position to appent the new item is given by
  	   data_start + (size_of_element * number_of_elm_in_stack) */
  
 
-	/* If full, double the size */
-	if (stack_full(my_stack)){
-		stack_resize(my_stack, (my_stack->max_size)*2);
+	/* If full, grow by the growth factor */
+	if (stack_full(my_stack) &&
+			stack_resize(my_stack, stack_grown_size(my_stack,
+					my_stack->size + 1))){
+		return 1;
 	}
 
 	void *cpy_start = stack_calc_address(my_stack, my_stack->size);
@@ -45,7 +185,23 @@ void stack_push(stack_t *const my_stack, void *item){
 	
 	memcpy(cpy_start, item, my_stack->el_size);
 	++(my_stack->size);
+	ds_stat_push(my_stack, 1, my_stack->size);
+
+	return 0;
+}
+
+/* ************************************************** */
 
+void *stack_emplace(stack_t *const my_stack){
+
+	if (stack_full(my_stack) &&
+			stack_resize(my_stack, stack_grown_size(my_stack,
+					my_stack->size + 1))){
+		return NULL;
+	}
+
+	ds_stat_push(my_stack, 1, my_stack->size + 1);
+	return stack_calc_address(my_stack, my_stack->size++);
 }
 
 /* ************************************************** */
@@ -62,10 +218,64 @@ unsigned int stack_pop(stack_t *const my_stack, void *item){
 	void *elem_pos = stack_calc_address(my_stack, my_stack->size - 1);
 
 	memcpy(item, elem_pos, my_stack->el_size);
-	return --(my_stack->size);
+	--(my_stack->size);
+	ds_stat_pop(my_stack, 1);
+
+	stack_shrink_check(my_stack);
+	return my_stack->size;
 	
 }
 
+/* ************************************************** */
+/**
+ * Grows the capacity until n more items fit, so the stack is resized
+ * at most once, and copies the whole run in one go.
+ */
+unsigned char stack_push_n(stack_t *const my_stack, const void *items,
+		unsigned int n){
+
+	unsigned int new_size;
+
+	if (n > ~0u - my_stack->size){
+		return 1; /* size + n would wrap */
+	}
+
+	new_size = stack_grown_size(my_stack, my_stack->size + n);
+	if (new_size != my_stack->max_size &&
+			stack_resize(my_stack, new_size)){
+		return 1;
+	}
+
+	memcpy(stack_calc_address(my_stack, my_stack->size), items,
+			my_stack->el_size * n);
+	my_stack->size += n;
+	ds_stat_push(my_stack, n, my_stack->size);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned int stack_pop_n(stack_t *const my_stack, void *items,
+		unsigned int n){
+
+	if (n > my_stack->size){
+		n = my_stack->size;
+	}
+
+	my_stack->size -= n;
+	ds_stat_pop(my_stack, n);
+
+	/* The popped run starts right where the stack now ends */
+	if (items != NULL){
+		memcpy(items, stack_calc_address(my_stack, my_stack->size),
+				my_stack->el_size * n);
+	}
+
+	stack_shrink_check(my_stack);
+	return n;
+}
+
 /* ************************************************** */
 
 unsigned int stack_top(stack_t *const my_s, void *item){
@@ -86,45 +296,143 @@ unsigned int stack_top(stack_t *const my_s, void *item){
 
 /* ************************************************** */
 
-inline unsigned char stack_full(stack_t *const my_s){
-	return (my_s->max_size == my_s->size);
+void *stack_top_ptr(stack_t *const my_s){
+
+	if (stack_empty(my_s)){
+		return NULL;
+	}
+
+	return stack_calc_address(my_s, my_s->size - 1);
 }
 
 /* ************************************************** */
 
-inline unsigned char stack_empty(stack_t *const my_s){
-	return (my_s->size == 0);
+void *stack_find(stack_t *const my_s, const void *key){
+
+	size_t i = elm_find(my_s->data, my_s->size, my_s->el_size, key);
+
+	ds_stat_cmp(my_s, (i < my_s->size) ? i + 1 : i);
+	return (i < my_s->size) ? stack_calc_address(my_s, i) : NULL;
 }
 
+
 /* ************************************************** */
 
-inline unsigned int stack_size(stack_t *const my_s){
-	return my_s->size;
+unsigned char stack_save(stack_t *const my_stack, int fd){
+
+	struct iovec iov = {my_stack->data, my_stack->el_size * my_stack->size};
+
+	if (snap_write_header(fd, my_stack->el_size, my_stack->size)){
+		return 1;
+	}
+
+	return snap_writev(fd, &iov, 1);
 }
 
+/* ************************************************** */
+
+unsigned char stack_load(stack_t *const my_stack, int fd){
+
+	snap_header_t hdr;
+	struct iovec iov;
+
+	if (snap_read_header(fd, &hdr) || hdr.count > ~0u){
+		return 1;
+	}
+
+	stack_init_capacity(my_stack, hdr.el_size, hdr.count);
+	if (my_stack->max_size < hdr.count){
+		stack_destroy(my_stack);
+		return 1;
+	}
+
+	iov.iov_base = my_stack->data;
+	iov.iov_len = hdr.el_size * hdr.count;
+	if (snap_readv(fd, &iov, 1)){
+		stack_destroy(my_stack);
+		return 1;
+	}
+
+	my_stack->size = hdr.count;
+	ds_stat_push(my_stack, hdr.count, hdr.count);
+
+	return 0;
+}
 
 /*
  * Private scope function
- * Returns a 0 if could resize it, or 1 if not
+ * Returns a 0 if could resize it, or 1 if not, leaving the stack as it was.
+ * Small buffers go through realloc, which can often grow in place. From
+ * STACK_MMAP_THRESHOLD bytes on, the buffer is moved once to an anonymous
+ * mapping, and later resizes remap its pages instead of copying them, so
+ * growing costs the pages touched, not the bytes stored. Once mapped it
+ * stays mapped.
  */
 static unsigned char stack_resize(stack_t *my_s, unsigned int new_size){
-	void *new_data, *freed_data;
+	size_t new_bytes = my_s->el_size * new_size;
+	size_t copied = 0;	/* Bytes moved to the new buffer */
+	void *new_data;
 	
-	//Less elements than we currently have.
-	if (new_size < my_s->size)
+	//Less elements than we currently have, or caller's buffer.
+	if (new_size < my_s->size || (my_s->flags & STACK_STATIC))
 		return 1; 
 
-	//Create new buffer
-	new_data = malloc(my_s->el_size * new_size);
-	//Copy data, doesnt check if overflows the reserved memory
-	memcpy(new_data, my_s->data, my_s->el_size * my_s->size);
+	//More bytes than a size_t holds, new_bytes wrapped. 0 size items fit.
+	if (my_s->el_size != 0 && new_size > SIZE_MAX / my_s->el_size)
+		return 1;
+
+#ifdef MREMAP_MAYMOVE
+	if (my_s->flags & STACK_MMAP){
+		new_data = mremap(my_s->data,
+				stack_map_len(my_s->el_size * my_s->max_size),
+				stack_map_len(new_bytes), MREMAP_MAYMOVE);
+		if (new_data == MAP_FAILED){
+			return 1;
+		}
+	} else if (new_bytes >= STACK_MMAP_THRESHOLD){
+		new_data = mmap(NULL, stack_map_len(new_bytes),
+				PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (new_data == MAP_FAILED){
+			return 1;
+		}
+		//Last copy this buffer will need
+		copied = my_s->el_size * my_s->size;
+		memcpy(new_data, my_s->data, copied);
+		free(my_s->data);
+		my_s->flags |= STACK_MMAP;
+	} else
+#endif
+	{
+		//realloc to 0 bytes may free the buffer and return NULL
+		new_data = realloc(my_s->data, new_bytes ? new_bytes : 1);
+		if (new_data == NULL){
+			return 1;
+		}
+		//Grown in place or moved, and then copied
+		if (new_data != my_s->data && my_s->data != NULL){
+			copied = my_s->el_size * my_s->size;
+		}
+	}
 
-	//Assign new data block
-	freed_data = my_s->data;
 	my_s->data = new_data;
-	
-	//Free memory
-	free(freed_data);
+	my_s->max_size = new_size;
+	ds_stat_resize(my_s, new_size, copied);
 	
 	return 0;
 }
+
+#ifdef DS_STATS
+
+/* ************************************************** */
+
+void stack_stats_dump(stack_t *const my_stack, FILE *f){
+	ds_stats_dump(&my_stack->stats, "stack", my_stack->size, f);
+}
+
+/* ************************************************** */
+
+void stack_set_resize_hook(stack_t *const my_stack, ds_resize_hook_t hook){
+	my_stack->stats.on_resize = hook;
+}
+
+#endif
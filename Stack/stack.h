@@ -9,6 +9,7 @@
 #define STACK_H_
 
 #include <stdlib.h> // For size_t
+#include "stats.h" // For the DS_STATS counters
 
 
 /*
@@ -18,12 +19,20 @@
  * @var el_size Size of each element in the stack. Should be constant.
  * @var max_size Maximum size of elements in the stack.
  * @var size Current size of the stack.
+ * @var min_size Capacity automatic shrinking never goes below.
+ * @var growth Growth factor in percent, 200 doubles.
+ * @var flags Storage mode and policy bits, internal.
+ * @var stats Counters, only in DS_STATS builds.
  */
 typedef struct stack{
 	void *data;				/* Actual data, generic */
 	size_t el_size;			/* Element size. Should be constant */
 	unsigned int max_size;	/* Number of elements allocated in data */
 	unsigned int size;		/* Number of inserted elements in data. Real data */
+	unsigned int min_size;	/* Shrink floor */
+	unsigned short growth;	/* Growth factor, percent */
+	unsigned char flags;	/* Storage mode */
+	DS_STATS_FIELD
 } stack_t; 
 
 /*
@@ -35,6 +44,33 @@ typedef struct stack{
  * @endcode 
  */
 void stack_init(stack_t *const my_s, size_t size);
+
+/*
+ * @brief Initialize a new stack with room for capacity elements, so a
+ * known working set doesn't go through the resizes of the warm up.
+ * @param [in] my_s Pointer to the stack to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] capacity Initial number of elements allocated. At least 1.
+ */
+void stack_init_capacity(stack_t *const my_s, size_t size,
+		unsigned int capacity);
+
+/*
+ * @brief Initialize a new stack over a buffer given by the caller. The
+ * stack never allocates, resizes or frees: pushes on a full stack fail
+ * instead, and every operation is O(1) with a single memcpy of el_size
+ * bytes, batches aside.
+ * @param [in] my_s Pointer to the stack to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] buf Buffer with room for capacity elements.
+ * @param [in] capacity Maximum number of elements.
+ * @code
+ * 		static int buf[64];
+ * 		stack_init_static(&s, sizeof(int), buf, 64);
+ * @endcode 
+ */
+void stack_init_static(stack_t *const my_s, size_t size, void *buf,
+		unsigned int capacity);
  
 /*
  * @brief Destroy the stack and free its resources.
@@ -42,12 +78,48 @@ void stack_init(stack_t *const my_s, size_t size);
  */
 void stack_destroy(stack_t *const my_stack);
 
+/*
+ * @brief Sets how the stack grows and shrinks.
+ * With automatic shrink, a pop leaving the stack a quarter full halves the
+ * capacity, never below the initial or reserved one. The gap between both
+ * thresholds keeps push/pop bursts around one size from thrashing.
+ * @param [in] my_s Pointer to the stack.
+ * @param [in] growth Growth factor in percent, above 100. 200 doubles,
+ * the default.
+ * @param [in] auto_shrink 1 to shrink automatically, 0 to never shrink.
+ */
+void stack_set_policy(stack_t *const my_s, unsigned short growth,
+		unsigned char auto_shrink);
+
+/*
+ * @brief Makes room for at least n elements in a single resize. The
+ * capacity reserved is kept by automatic shrinking.
+ * @param [in] my_s Pointer to the stack.
+ * @param [in] n Number of elements.
+ * @return Status of the operation.
+ * @retval 0 Room available.
+ * @retval 1 Could not grow the stack.
+ */
+unsigned char stack_reserve(stack_t *const my_s, unsigned int n);
+
+/*
+ * @brief Shrinks the buffer to the current number of elements.
+ * @param [in] my_s Pointer to the stack.
+ * @return Status of the operation.
+ * @retval 0 Buffer shrunk.
+ * @retval 1 Could not resize, the stack is unchanged.
+ */
+unsigned char stack_shrink_to_fit(stack_t *const my_s);
+
 /*
  * @brief Adds a new element to the stack.
  * @param [in] my_stack Pointer to the stack where will add the item.
  * @param [in] item Pointer to the item to be attached.
+ * @return Status of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Full stack that can't grow, nothing pushed.
  */
-void stack_push(stack_t *const my_stack, void *item);
+unsigned char stack_push(stack_t *const my_stack, void *item);
 
 /*
  * @brief Returns the top element of the stack and deletes it.
@@ -57,6 +129,32 @@ void stack_push(stack_t *const my_stack, void *item);
  */
 unsigned int stack_pop(stack_t *const my_stack, void *item);
 
+/*
+ * @brief Adds n elements to the stack at once. Grows the stack at most
+ * once and copies all of them with a single memcpy.
+ * @param [in] my_stack Pointer to the stack where will add the items.
+ * @param [in] items Array of n items, items[n - 1] ends up on top.
+ * @param [in] n Number of items.
+ * @return Status of the operation.
+ * @retval 0 Items pushed.
+ * @retval 1 Could not grow the stack, or size + n does not fit in an
+ * unsigned int, nothing pushed.
+ */
+unsigned char stack_push_n(stack_t *const my_stack, const void *items,
+		unsigned int n);
+
+/*
+ * @brief Removes up to n elements from the top of the stack at once. They
+ * are copied in stack order, so the old top ends up last and a push_n of
+ * the same array puts them back as they were.
+ * @param [in] my_stack Pointer to the stack to be popped.
+ * @param [out] items Array with room for n items. Could be NULL.
+ * @param [in] n Maximum number of items to pop.
+ * @return Number of items popped.
+ */
+unsigned int stack_pop_n(stack_t *const my_stack, void *items,
+		unsigned int n);
+
 /*
  * @brief Gets the last element added.
  * @param [in] my_stack Pointer to the stack to be checked.
@@ -65,6 +163,79 @@ unsigned int stack_pop(stack_t *const my_stack, void *item);
  */
 unsigned int stack_top(stack_t *const my_stack, void *item);
 
+/*
+ * @brief Adds a new element to the stack without copying it in. The slot
+ * returned is to be filled by the caller, and stays valid until the next
+ * call modifying the stack.
+ * @param [in] my_stack Pointer to the stack where will add the item.
+ * @return Pointer to the new top slot, uninitialized.
+ * @retval NULL Full stack that can't grow, nothing pushed.
+ */
+void *stack_emplace(stack_t *const my_stack);
+
+/*
+ * @brief Gets the last element added in place, without copying it. The
+ * pointer stays valid until the next call modifying the stack.
+ * @param [in] my_stack Pointer to the stack to be checked.
+ * @return Pointer to the top element.
+ * @retval NULL Empty stack.
+ */
+void *stack_top_ptr(stack_t *const my_stack);
+
+/*
+ * @brief Finds the element closest to the bottom equal to key, byte by
+ * byte. Sizes of 1, 2, 4 and 8 bytes are compared many at a time.
+ * @param [in] my_stack Pointer to the stack to be searched.
+ * @param [in] key Pointer to the searched value.
+ * @return Pointer to the element in place, valid until the next call
+ * modifying the stack.
+ * @retval NULL Not found.
+ */
+void *stack_find(stack_t *const my_stack, const void *key);
+
+/*
+ * @brief Writes the elements to a file, bottom to top, after a header
+ * with their size and number (see Common/snapshot.h). The data goes out
+ * in a single write.
+ * @param [in] my_stack Pointer to the stack.
+ * @param [in] fd File descriptor to write to, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 Stack saved.
+ * @retval 1 Write error.
+ */
+unsigned char stack_save(stack_t *const my_stack, int fd);
+
+/*
+ * @brief Initialize a new stack from a snapshot, like the ones written by
+ * stack_save, queue_save and list_save. The element size is the one
+ * saved, the buffer is allocated once with room for exactly the elements
+ * saved, and they're read straight into it.
+ * @param [in] my_stack Pointer to the stack to be initialized.
+ * @param [in] fd File descriptor to read from, at its current offset.
+ * @return Status of the operation.
+ * @retval 0 Stack loaded.
+ * @retval 1 Read error, bad snapshot or out of memory. The stack is not
+ * initialized.
+ */
+unsigned char stack_load(stack_t *const my_stack, int fd);
+
+#ifdef DS_STATS
+/*
+ * @brief Writes the stack counters to a stream, as one JSON line.
+ * @param [in] my_stack Pointer to the stack.
+ * @param [in] f Stream to write to.
+ */
+void stack_stats_dump(stack_t *const my_stack, FILE *f);
+
+/*
+ * @brief Sets a function to be called on every resize with the old and
+ * new capacity.
+ * @param [in] my_stack Pointer to the stack.
+ * @param [in] hook Function to call, NULL for none.
+ */
+void stack_set_resize_hook(stack_t *const my_stack, ds_resize_hook_t hook);
+#endif
+
 /*
  * @brief Checks if the stack is full.
  * @param [in] my_stack Pointer to the stack to be checked.
@@ -72,7 +243,10 @@ unsigned int stack_top(stack_t *const my_stack, void *item);
  * @retval 1 Full stack.
  * @retval 0 Not full stack.
  */
-inline unsigned char stack_full(stack_t *const my_s);
+static inline unsigned char stack_full(stack_t *const my_s)
+{
+	return (my_s->max_size == my_s->size);
+}
 
 /*
  * @brief Checks if the stack is empty.
@@ -81,13 +255,19 @@ inline unsigned char stack_full(stack_t *const my_s);
  * @retval 1 Empty stack.
  * @retval 0 Not empty stack.
  */
-inline unsigned char stack_empty(stack_t *const my_s);
+static inline unsigned char stack_empty(stack_t *const my_s)
+{
+	return (my_s->size == 0);
+}
 
 /*
  * @brief Returns the number of allocated items.
  * @param [in] my_stack Pointer to the stack to be checked.
  * @return Number of items in the stack.
  */
-inline unsigned int stack_size(stack_t *const my_s);
+static inline unsigned int stack_size(stack_t *const my_s)
+{
+	return my_s->size;
+}
 
 #endif /* STACK_H_ */
@@ -0,0 +1,149 @@
+#include "stack_lf.h"
+#include <stdlib.h> //For malloc and free
+#include <string.h>  //For memcpy
+
+/**
+ * @brief Macro to get the element of a node.
+ * @param stack Pointer to the stack structure.
+ * @param n Node number + 1, as kept in the links.
+ */
+#define stack_lf_calc_address(stack, n)			\
+	((stack)->data + (stack)->el_size * ((n) - 1))
+
+/**
+ * @brief Macro to build a top word from the one it replaces and the new
+ * node number + 1.
+ */
+#define stack_lf_word(old, n)					\
+	((((old) >> 32) + 1) << 32 | (uint32_t) (n))
+
+/* ************************************************** */
+/**
+ * @brief Unlinks the first node of a list, used or free.
+ * The link below the old first node may be overwritten by another thread
+ * as soon as that node is taken and given back, but then the tag has
+ * changed and the compare and swap fails, so a stale link is never
+ * installed.
+ * @param my_s Pointer to the stack.
+ * @param list Top word of the list.
+ * @return Node number + 1 taken, 0 if the list was empty.
+ */
+static unsigned int stack_lf_take(stack_lf_t *const my_s,
+		_Atomic uint64_t *list){
+
+	uint64_t old = atomic_load_explicit(list, memory_order_acquire);
+	uint64_t new;
+	unsigned int n;
+
+	do {
+		n = (uint32_t) old;
+		if (n == 0){
+			return 0;
+		}
+		new = stack_lf_word(old, atomic_load_explicit(&my_s->next[n - 1],
+				memory_order_relaxed));
+	} while (!atomic_compare_exchange_weak_explicit(list, &old, new,
+			memory_order_acquire, memory_order_acquire));
+
+	return n;
+}
+
+/* ************************************************** */
+/**
+ * @brief Links a node first in a list, used or free. The release of the
+ * compare and swap publishes both the link and whatever was written to
+ * the node before.
+ * @param my_s Pointer to the stack.
+ * @param list Top word of the list.
+ * @param n Node number + 1 to give.
+ */
+static void stack_lf_give(stack_lf_t *const my_s, _Atomic uint64_t *list,
+		unsigned int n){
+
+	uint64_t old = atomic_load_explicit(list, memory_order_relaxed);
+
+	do {
+		atomic_store_explicit(&my_s->next[n - 1], (uint32_t) old,
+				memory_order_relaxed);
+	} while (!atomic_compare_exchange_weak_explicit(list, &old,
+			stack_lf_word(old, n), memory_order_release,
+			memory_order_relaxed));
+}
+
+/* ************************************************** */
+/**
+ * Every node starts in the free list, in order.
+ */
+unsigned char stack_lf_init(stack_lf_t *const my_s, size_t size,
+		unsigned int capacity){
+
+	unsigned int i;
+
+	/* Node numbers + 1 must fit the low half of the top word */
+	if (capacity == 0 || capacity == ~0u){
+		return 1;
+	}
+
+	my_s->next = malloc(sizeof(atomic_uint) * capacity);
+	my_s->data = malloc(size * capacity);
+	if (my_s->next == NULL || my_s->data == NULL){
+		free(my_s->next);
+		free(my_s->data);
+		return 1;
+	}
+
+	for (i = 0; i < capacity; ++i){
+		atomic_init(&my_s->next[i], (i + 1 < capacity) ? i + 2 : 0);
+	}
+
+	my_s->el_size = size;
+	my_s->capacity = capacity;
+	atomic_init(&my_s->top, 0);
+	atomic_init(&my_s->free, 1);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+void stack_lf_destroy(stack_lf_t *const my_s){
+	free(my_s->next);
+	free(my_s->data);
+}
+
+/* ************************************************** */
+/**
+ * The node taken from the free list belongs to this thread alone until
+ * it's given to the used list, so the copy needs no ordering of its own.
+ */
+unsigned char stack_lf_try_push(stack_lf_t *const my_s, const void *item){
+
+	unsigned int n = stack_lf_take(my_s, &my_s->free);
+
+	if (n == 0){
+		return 1; /* Full */
+	}
+
+	memcpy(stack_lf_calc_address(my_s, n), item, my_s->el_size);
+	stack_lf_give(my_s, &my_s->top, n);
+
+	return 0;
+}
+
+/* ************************************************** */
+
+unsigned char stack_lf_try_pop(stack_lf_t *const my_s, void *item){
+
+	unsigned int n = stack_lf_take(my_s, &my_s->top);
+
+	if (n == 0){
+		return 1; /* Empty */
+	}
+
+	if (item != NULL){
+		memcpy(item, stack_lf_calc_address(my_s, n), my_s->el_size);
+	}
+	stack_lf_give(my_s, &my_s->free, n);
+
+	return 0;
+}
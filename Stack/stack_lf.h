@@ -0,0 +1,94 @@
+/**
+ * @file stack_lf.h
+ * @author Juan Manuel Torres Palma
+ * @brief Lock-free bounded stack declaration file
+ */
+
+#ifndef STACK_LF_H_
+#define STACK_LF_H_
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For int types
+#include <stdatomic.h> // For atomic tops
+
+#define STACK_CACHE_LINE 64 // Bytes per cache line
+
+/*
+ * @brief A generic bounded LIFO any number of threads can push to and pop
+ * from at the same time (Treiber stack). Elements live in a node array
+ * allocated at init; free nodes are kept in a second stack of the same
+ * kind, so nodes are never freed while the stack is in use and a thread
+ * reading a node that was just popped by another one reads stale, not
+ * released, memory.
+ * Each top word packs a node number in its low 32 bits and a tag in the
+ * high ones, bumped on every change, so a compare and swap fails if the
+ * top was popped and pushed back in between (ABA).
+ * @var top Tag and node number + 1 of the top element, 0 if empty.
+ * @var free Tag and node number + 1 of the first free node.
+ * @var next Node number + 1 below each node, 0 at the bottom.
+ * @var data Element of each node.
+ * @var el_size Size of each element in the stack. Should be constant.
+ * @var capacity Number of nodes.
+ */
+typedef struct stack_lf{
+	_Alignas(STACK_CACHE_LINE) _Atomic uint64_t top;	/* Used nodes */
+	_Alignas(STACK_CACHE_LINE) _Atomic uint64_t free;	/* Free nodes */
+	_Alignas(STACK_CACHE_LINE) atomic_uint *next;		/* Links */
+	unsigned char *data;		/* Actual data */
+	size_t el_size;				/* Element size. Should be constant */
+	unsigned int capacity;		/* Number of nodes */
+} stack_lf_t;
+
+/*
+ * @brief Initialize a new stack. Must be done before sharing it.
+ * @param [in] my_s Pointer to the stack to be initialized.
+ * @param [in] size Size in bytes of a single element.
+ * @param [in] capacity Maximum number of elements.
+ * @return Status of the allocation.
+ * @retval 0 Stack ready.
+ * @retval 1 Could not allocate the nodes.
+ * @code
+ * 		stack_lf_init(&s, sizeof(void *), 1024);
+ * @endcode
+ */
+unsigned char stack_lf_init(stack_lf_t *const my_s, size_t size,
+		unsigned int capacity);
+
+/*
+ * @brief Destroy the stack and free its resources. No thread can be
+ * using it anymore.
+ * @param my_s Pointer to the stack to be freed up.
+ */
+void stack_lf_destroy(stack_lf_t *const my_s);
+
+/*
+ * @brief Adds a new element on top of the stack if there's a free node.
+ * @param [in] my_s Pointer to the stack where will add the item.
+ * @param [in] item Pointer to the item to be copied in.
+ * @return Result of the operation.
+ * @retval 0 Item pushed.
+ * @retval 1 Full stack, nothing done.
+ */
+unsigned char stack_lf_try_push(stack_lf_t *const my_s, const void *item);
+
+/*
+ * @brief Removes the top element of the stack if any.
+ * @param [in] my_s Pointer to the stack to be popped.
+ * @param [out] item Pointer to store the value. Could be NULL.
+ * @return Result of the operation.
+ * @retval 0 Item popped.
+ * @retval 1 Empty stack, nothing done.
+ */
+unsigned char stack_lf_try_pop(stack_lf_t *const my_s, void *item);
+
+/*
+ * @brief Returns the capacity of the stack.
+ * @param [in] my_s Pointer to the stack to be checked.
+ * @return Number of nodes.
+ */
+static inline unsigned int stack_lf_capacity(stack_lf_t *const my_s)
+{
+	return my_s->capacity;
+}
+
+#endif /* STACK_LF_H_ */
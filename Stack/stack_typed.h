@@ -0,0 +1,70 @@
+/**
+ * @file stack_typed.h
+ * @author Juan Manuel Torres Palma
+ * @brief Type specialized front-end over the generic C stack
+ */
+
+#ifndef STACK_TYPED_H_
+#define STACK_TYPED_H_
+
+#include "stack.h"
+
+/*
+ * @brief Generates inline functions to use a stack_t holding elements of
+ * a known type. Element size is a compile time constant, so copies become
+ * plain loads and stores. The stack is a regular stack_t, and the slow
+ * paths, growth included, go through the generic functions, so both APIs
+ * can be mixed on the same stack. Typed pushes and pops update the
+ * DS_STATS counters too. Typed pops never trigger automatic shrinking,
+ * use stack_shrink_to_fit for that.
+ * Only the types actually used pay the extra code size.
+ * @param name Suffix of the generated functions.
+ * @param type Element type.
+ * @code
+ * 		DECLARE_STACK(int32, int32_t)
+ *
+ * 		stack_int32_init(&s);
+ * 		stack_int32_push(&s, 42);
+ * 		stack_int32_pop(&s, &v);
+ * @endcode
+ */
+#define DECLARE_STACK(name, type)											\
+																			\
+static inline void stack_##name##_init(stack_t *const my_s)					\
+{																			\
+	stack_init(my_s, sizeof(type));											\
+}																			\
+																			\
+static inline unsigned char stack_##name##_push(stack_t *const my_s,		\
+		type item)															\
+{																			\
+	if (stack_full(my_s)){													\
+		return stack_push(my_s, &item);										\
+	}																		\
+	((type *) my_s->data)[my_s->size++] = item;								\
+	ds_stat_push(my_s, 1, my_s->size);										\
+	return 0;																\
+}																			\
+																			\
+static inline unsigned int stack_##name##_pop(stack_t *const my_s,			\
+		type *item)															\
+{																			\
+	if (stack_empty(my_s)){													\
+		return 0;															\
+	}																		\
+	*item = ((type *) my_s->data)[--my_s->size];							\
+	ds_stat_pop(my_s, 1);													\
+	return my_s->size;														\
+}																			\
+																			\
+static inline unsigned int stack_##name##_top(stack_t *const my_s,			\
+		type *item)															\
+{																			\
+	if (stack_empty(my_s)){													\
+		return 0;															\
+	}																		\
+	*item = ((type *) my_s->data)[my_s->size - 1];							\
+	return my_s->size;														\
+}
+
+#endif /* STACK_TYPED_H_ */